@@ -0,0 +1,100 @@
+#include "BackgroundWriter.h"
+#include <utility>
+#include <algorithm>
+#include <cerrno>
+using namespace std;
+
+BackgroundWriter::BackgroundWriter(FILE* file, size_t bufferSize, size_t bufferCount)
+    : file(file)
+{
+    //At least one buffer is filled while another one is written
+    for (size_t i = 0; i < max<size_t>(bufferCount, 2); ++i)
+    {
+        freeBuffers.emplace_back(bufferSize);
+    }
+    writer = thread(&BackgroundWriter::writerLoop, this);
+}
+
+BackgroundWriter::~BackgroundWriter()
+{
+    finish();
+}
+
+vector<char> BackgroundWriter::takeBuffer()
+{
+    unique_lock<mutex> lock(queueMutex);
+    bufferWritten.wait(lock, [this] { return !freeBuffers.empty(); });
+    vector<char> buffer = move(freeBuffers.back());
+    freeBuffers.pop_back();
+    return buffer;
+}
+
+void BackgroundWriter::write(vector<char> buffer, size_t length)
+{
+    {
+        lock_guard<mutex> lock(queueMutex);
+        queue.emplace_back(move(buffer), length);
+    }
+    bufferQueued.notify_one();
+}
+
+void BackgroundWriter::finish()
+{
+    if (!writer.joinable())
+    {
+        return;
+    }
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    bufferQueued.notify_one();
+    writer.join();
+}
+
+int BackgroundWriter::error()
+{
+    lock_guard<mutex> lock(queueMutex);
+    return firstError;
+}
+
+void BackgroundWriter::writerLoop()
+{
+    while (true)
+    {
+        pair<vector<char>, size_t> next;
+        bool failed;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            bufferQueued.wait(lock, [this] { return stopping || !queue.empty(); });
+            //Everything in the queue is written before the thread stops
+            if (queue.empty())
+            {
+                return;
+            }
+            next = move(queue.front());
+            queue.pop_front();
+            failed = firstError != 0;
+        }
+
+        //The file is only used by this thread, so it is written without holding the lock.
+        //After a failed write the file is missing a part, so the rest is not written
+        int writeError = 0;
+        errno = 0;
+        if (!failed && fwrite(next.first.data(), 1, next.second, file) != next.second)
+        {
+            //errno is per thread, so it belongs to this fwrite. It is not always set, then EIO is used
+            writeError = errno != 0 ? errno : EIO;
+        }
+
+        {
+            lock_guard<mutex> lock(queueMutex);
+            if (firstError == 0)
+            {
+                firstError = writeError;
+            }
+            freeBuffers.push_back(move(next.first));
+        }
+        bufferWritten.notify_one();
+    }
+}
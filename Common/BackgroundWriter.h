@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+//Writes buffers to a file on its own thread, so the program can fill the next buffer while the last one is written.
+//There is a fixed number of buffers (3 by default): one is filled, and the others are waiting to be written or are
+//being written. When all of them are full, takeBuffer waits for the writer, so the memory used never grows past
+//bufferCount * bufferSize, even when the disk is much slower than the program
+class BackgroundWriter
+{
+public:
+    //The file is not closed by this class. It must stay open until finish() has returned
+    BackgroundWriter(std::FILE* file, size_t bufferSize, size_t bufferCount = 3);
+    ~BackgroundWriter();
+
+    BackgroundWriter(const BackgroundWriter&) = delete;
+    BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+    //Returns an empty buffer of bufferSize bytes. Waits when every buffer is still waiting to be written
+    std::vector<char> takeBuffer();
+
+    //Gives the buffer back to be written. Only the first 'length' bytes go to the file, in the order the buffers are given
+    void write(std::vector<char> buffer, size_t length);
+
+    //Waits until everything that was given to write() is in the file, and stops the thread
+    void finish();
+
+    //The error number (errno) of the first write that did not write all its bytes, or 0 when every write so far went
+    //well. After a failed write the rest of the buffers are not written. Call it after finish() to know about all writes
+    int error();
+
+private:
+    void writerLoop();
+
+    std::FILE* file;
+    std::mutex queueMutex;
+    std::condition_variable bufferWritten;
+    std::condition_variable bufferQueued;
+    //Buffers waiting to be written, with the number of bytes to write from each
+    std::deque<std::pair<std::vector<char>, size_t>> queue;
+    std::vector<std::vector<char>> freeBuffers;
+    bool stopping = false;
+    int firstError = 0;
+    std::thread writer;
+};
@@ -0,0 +1,579 @@
+#include "BulkWriter.h"
+#include <stdexcept>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <cerrno>
+#endif
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+using namespace std;
+
+namespace
+{
+    //O_DIRECT needs the memory, the file offset and the length of every write to be a multiple of the block size of
+    //the disk. 4096 is a multiple of it on the disks in use today
+    const size_t alignment = 4096;
+
+    size_t alignUp(size_t value)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+#ifndef _WIN32
+    string errorText(int error)
+    {
+        return strerror(error);
+    }
+#endif
+}
+
+struct BulkWriter::Chunk
+{
+    char* data = nullptr;
+    //The bytes filled, and the bytes written, which includes the padding up to 4096 with O_DIRECT
+    size_t used = 0;
+    size_t length = 0;
+    uint64_t offset = 0;
+    bool inFlight = false;
+#ifdef __linux__
+    iovec buffer;
+#endif
+};
+
+#ifdef __linux__
+
+//The queues io_uring shares with the kernel. The program puts write requests in the submission ring and the kernel puts
+//their results in the completion ring. Both rings are mapped from the ring file descriptor
+struct BulkWriter::Ring
+{
+    int fileDescriptor = -1;
+    void* submissionMemory = MAP_FAILED;
+    size_t submissionSize = 0;
+    void* completionMemory = MAP_FAILED;
+    size_t completionSize = 0;
+    io_uring_sqe* entries = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t entriesSize = 0;
+
+    unsigned* submissionTail = nullptr;
+    unsigned* submissionMask = nullptr;
+    unsigned* submissionArray = nullptr;
+    unsigned* completionHead = nullptr;
+    unsigned* completionTail = nullptr;
+    unsigned* completionMask = nullptr;
+    io_uring_cqe* completions = nullptr;
+
+    //Returns false when the kernel has no io_uring or does not allow it
+    bool setup(unsigned depth)
+    {
+        io_uring_params parameters;
+        memset(&parameters, 0, sizeof(parameters));
+        fileDescriptor = static_cast<int>(syscall(__NR_io_uring_setup, depth, &parameters));
+        if (fileDescriptor < 0)
+        {
+            return false;
+        }
+
+        submissionSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        completionSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+        //Newer kernels map both rings with one call
+        bool singleMap = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+        {
+            submissionSize = completionSize = max(submissionSize, completionSize);
+        }
+
+        submissionMemory = mmap(nullptr, submissionSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            fileDescriptor, IORING_OFF_SQ_RING);
+        if (submissionMemory == MAP_FAILED)
+        {
+            return false;
+        }
+        completionMemory = singleMap ? submissionMemory : mmap(nullptr, completionSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fileDescriptor, IORING_OFF_CQ_RING);
+        if (completionMemory == MAP_FAILED)
+        {
+            return false;
+        }
+        entriesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+        entries = static_cast<io_uring_sqe*>(mmap(nullptr, entriesSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fileDescriptor, IORING_OFF_SQES));
+        if (entries == MAP_FAILED)
+        {
+            return false;
+        }
+
+        char* submission = static_cast<char*>(submissionMemory);
+        submissionTail = reinterpret_cast<unsigned*>(submission + parameters.sq_off.tail);
+        submissionMask = reinterpret_cast<unsigned*>(submission + parameters.sq_off.ring_mask);
+        submissionArray = reinterpret_cast<unsigned*>(submission + parameters.sq_off.array);
+        char* completion = static_cast<char*>(completionMemory);
+        completionHead = reinterpret_cast<unsigned*>(completion + parameters.cq_off.head);
+        completionTail = reinterpret_cast<unsigned*>(completion + parameters.cq_off.tail);
+        completionMask = reinterpret_cast<unsigned*>(completion + parameters.cq_off.ring_mask);
+        completions = reinterpret_cast<io_uring_cqe*>(completion + parameters.cq_off.cqes);
+        return true;
+    }
+
+    //Puts a write of the chunk in the submission ring and tells the kernel. Returns the error number, or 0
+    int submitWrite(int file, iovec* buffer, uint64_t offset, uint64_t userData)
+    {
+        //Only this thread adds entries, so the tail can be read without waiting for the kernel
+        unsigned tail = *submissionTail;
+        unsigned index = tail & *submissionMask;
+        io_uring_sqe& entry = entries[index];
+        memset(&entry, 0, sizeof(entry));
+        //WRITEV has been in io_uring from the start (Linux 5.1), WRITE only from 5.6
+        entry.opcode = IORING_OP_WRITEV;
+        entry.fd = file;
+        entry.addr = reinterpret_cast<uint64_t>(buffer);
+        entry.len = 1;
+        entry.off = offset;
+        entry.user_data = userData;
+        submissionArray[index] = index;
+        //The entry must be complete before the kernel can see the new tail
+        __atomic_store_n(submissionTail, tail + 1, __ATOMIC_RELEASE);
+
+        while (syscall(__NR_io_uring_enter, fileDescriptor, 1, 0, 0, nullptr, 0) < 0)
+        {
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                return errno;
+            }
+        }
+        return 0;
+    }
+
+    ~Ring()
+    {
+        if (entries != MAP_FAILED)
+        {
+            munmap(entries, entriesSize);
+        }
+        if (completionMemory != MAP_FAILED && completionMemory != submissionMemory)
+        {
+            munmap(completionMemory, completionSize);
+        }
+        if (submissionMemory != MAP_FAILED)
+        {
+            munmap(submissionMemory, submissionSize);
+        }
+        if (fileDescriptor >= 0)
+        {
+            ::close(fileDescriptor);
+        }
+    }
+};
+
+#else
+
+//There is no io_uring, so the chunks are always written with writeNow
+struct BulkWriter::Ring
+{
+};
+
+#endif
+
+BulkWriter::BulkWriter(const string& path, uint64_t expectedSize, bool direct, size_t chunkSize, unsigned queueDepth)
+    : path(path), chunkSize(alignUp(max<size_t>(chunkSize, 1)))
+{
+    queueDepth = max(queueDepth, 2u);
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_SEQUENTIAL_SCAN,
+        nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw runtime_error("Could not open " + path + " for writing");
+    }
+    fileHandle = file;
+    (void)direct;
+    if (expectedSize > 0)
+    {
+        FILE_ALLOCATION_INFO allocation;
+        allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(expectedSize);
+        SetFileInformationByHandle(file, FileAllocationInfo, &allocation, sizeof(allocation));
+    }
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    if (direct)
+    {
+        fileDescriptor = open(path.c_str(), flags | O_DIRECT, 0644);
+        directIo = fileDescriptor >= 0;
+    }
+#endif
+    if (fileDescriptor < 0)
+    {
+        fileDescriptor = open(path.c_str(), flags, 0644);
+    }
+    if (fileDescriptor < 0)
+    {
+        throw runtime_error("Could not open " + path + " for writing: " + errorText(errno));
+    }
+#ifdef __linux__
+    //Reserves the blocks without changing the size of the file. It does not matter if the file system can not do it
+    if (expectedSize > 0)
+    {
+        fallocate(fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expectedSize));
+    }
+
+    ring.reset(new Ring());
+    if (!ring->setup(queueDepth))
+    {
+        ring.reset();
+    }
+#endif
+#endif
+
+    //One block of memory for all the chunks, starting at a multiple of 4096
+    memory.resize(this->chunkSize * queueDepth + alignment);
+    char* first = memory.data() + (alignment - reinterpret_cast<uintptr_t>(memory.data()) % alignment) % alignment;
+    chunks.resize(queueDepth);
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        chunks[i].data = first + i * this->chunkSize;
+    }
+}
+
+BulkWriter::~BulkWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const runtime_error&)
+    {
+        //The error can not be reported from a destructor. Call close() to see it
+    }
+}
+
+string BulkWriter::method() const
+{
+#ifdef _WIN32
+    return "WriteFile";
+#else
+    return string(ring ? "io_uring" : "pwrite") + (directIo ? " with O_DIRECT" : "");
+#endif
+}
+
+void BulkWriter::write(const void* data, size_t length)
+{
+    if (closed)
+    {
+        throw runtime_error(path + " has been closed");
+    }
+    //After a failed write the chunks may still be in use, so nothing more is written
+    throwFailure();
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0)
+    {
+        Chunk& chunk = chunks[current];
+        size_t part = min(length, chunkSize - chunk.used);
+        memcpy(chunk.data + chunk.used, bytes, part);
+        chunk.used += part;
+        written += part;
+        bytes += part;
+        length -= part;
+        if (chunk.used == chunkSize)
+        {
+            submitChunk();
+        }
+    }
+}
+
+void BulkWriter::submitChunk()
+{
+    Chunk& chunk = chunks[current];
+    chunk.offset = nextOffset;
+    nextOffset += chunk.used;
+    chunk.length = chunk.used;
+    if (directIo)
+    {
+        //Only the last chunk can be partly filled. It is padded with zeros, and close() cuts the file to the right size
+        chunk.length = alignUp(chunk.used);
+        memset(chunk.data + chunk.used, 0, chunk.length - chunk.used);
+    }
+
+#ifdef __linux__
+    if (ring)
+    {
+        chunk.buffer.iov_base = chunk.data;
+        chunk.buffer.iov_len = chunk.length;
+        int error = ring->submitWrite(fileDescriptor, &chunk.buffer, chunk.offset, current);
+        if (error == 0)
+        {
+            chunk.inFlight = true;
+        }
+        else if (failure.empty())
+        {
+            failure = "Could not write " + path + ": " + errorText(error);
+        }
+    }
+    else
+#endif
+    {
+        writeNow(chunk.data, chunk.length, chunk.offset);
+    }
+    if (!chunk.inFlight)
+    {
+        chunk.used = 0;
+    }
+
+    //The chunks are used in turn, so the next one is the one that was submitted longest ago
+    current = (current + 1) % chunks.size();
+    while (chunks[current].inFlight)
+    {
+        if (!collectCompletions(true))
+        {
+            break;
+        }
+    }
+    throwFailure();
+}
+
+bool BulkWriter::writeNow(const char* data, size_t length, uint64_t offset)
+{
+#ifdef _WIN32
+    //The chunks are written in order, so the file position is always at the offset
+    (void)offset;
+    while (length > 0)
+    {
+        DWORD part = static_cast<DWORD>(min<size_t>(length, 1u << 30));
+        DWORD done = 0;
+        if (!WriteFile(static_cast<HANDLE>(fileHandle), data, part, &done, nullptr) || done == 0)
+        {
+            if (failure.empty())
+            {
+                failure = "Could not write " + path;
+            }
+            return false;
+        }
+        data += done;
+        length -= done;
+    }
+#else
+    while (length > 0)
+    {
+        ssize_t done = pwrite(fileDescriptor, data, length, static_cast<off_t>(offset));
+        if (done < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (done <= 0)
+        {
+            if (failure.empty())
+            {
+                failure = "Could not write " + path + ": " + errorText(done < 0 ? errno : ENOSPC);
+            }
+            return false;
+        }
+        data += done;
+        length -= done;
+        offset += done;
+    }
+#endif
+    return true;
+}
+
+bool BulkWriter::collectCompletions(bool wait)
+{
+#ifdef __linux__
+    if (!ring)
+    {
+        return true;
+    }
+    //Only this thread takes results, so the head can be read without waiting for the kernel
+    unsigned head = *ring->completionHead;
+    unsigned tail = __atomic_load_n(ring->completionTail, __ATOMIC_ACQUIRE);
+    while (wait && head == tail)
+    {
+        if (syscall(__NR_io_uring_enter, ring->fileDescriptor, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+            errno != EINTR)
+        {
+            if (failure.empty())
+            {
+                failure = "Could not wait for the writes to " + path + ": " + errorText(errno);
+            }
+            return false;
+        }
+        tail = __atomic_load_n(ring->completionTail, __ATOMIC_ACQUIRE);
+    }
+
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe& completion = ring->completions[head & *ring->completionMask];
+        Chunk& chunk = chunks[completion.user_data];
+        int result = completion.res;
+        if (result < 0)
+        {
+            if (failure.empty())
+            {
+                failure = "Could not write " + path + ": " + errorText(-result);
+            }
+        }
+        else if (static_cast<size_t>(result) < chunk.length)
+        {
+            //A short write, for example when the disk is almost full. The rest is written here and fails if it is full
+            writeNow(chunk.data + result, chunk.length - result, chunk.offset + result);
+        }
+        chunk.inFlight = false;
+        chunk.used = 0;
+    }
+    __atomic_store_n(ring->completionHead, head, __ATOMIC_RELEASE);
+#else
+    (void)wait;
+#endif
+    return true;
+}
+
+void BulkWriter::throwFailure()
+{
+    if (!failure.empty())
+    {
+        throw runtime_error(failure);
+    }
+}
+
+void BulkWriter::close()
+{
+    if (closed)
+    {
+        return;
+    }
+    closed = true;
+
+    if (chunks[current].used > 0)
+    {
+        Chunk& chunk = chunks[current];
+        chunk.offset = nextOffset;
+        nextOffset += chunk.used;
+        chunk.length = directIo ? alignUp(chunk.used) : chunk.used;
+        memset(chunk.data + chunk.used, 0, chunk.length - chunk.used);
+        writeNow(chunk.data, chunk.length, chunk.offset);
+        chunk.used = 0;
+    }
+    //The memory of the chunks must not be freed before the kernel is done with them, so this waits even after an error
+    for (const Chunk& chunk : chunks)
+    {
+        while (chunk.inFlight)
+        {
+            if (!collectCompletions(true))
+            {
+                //It is unknown when the kernel is done with the chunks, so their memory is left to it
+                new vector<char>(move(memory));
+                break;
+            }
+        }
+    }
+    ring.reset();
+
+#ifdef _WIN32
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+    fileHandle = nullptr;
+#else
+    //Removes the padding of the last chunk
+    if (ftruncate(fileDescriptor, static_cast<off_t>(written)) != 0 && failure.empty())
+    {
+        failure = "Could not set the size of " + path + ": " + errorText(errno);
+    }
+    if (::close(fileDescriptor) != 0 && failure.empty())
+    {
+        failure = "Could not close " + path + ": " + errorText(errno);
+    }
+    fileDescriptor = -1;
+#endif
+    throwFailure();
+}
+
+namespace
+{
+    //Waits until the file is on the disk, so the time of ofstream is not only the time to copy into the page cache
+    void syncFile(const char* path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0,
+            nullptr);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            FlushFileBuffers(file);
+            CloseHandle(file);
+        }
+#else
+        int file = open(path, O_WRONLY);
+        if (file >= 0)
+        {
+            fsync(file);
+            ::close(file);
+        }
+#endif
+    }
+}
+
+void benchmarkBulkWriter(size_t megabytes)
+{
+    const char* path = "BulkWriterBenchmark.bin";
+    const size_t blockSize = 1 << 20;
+    //z values of the Oppgave3 surface, written one MB at a time like the columns of a large Data.bin
+    vector<float> block(blockSize / sizeof(float));
+    for (size_t i = 0; i < block.size(); ++i)
+    {
+        double x = -2.0 + 4.0 * (i / 512) / 511.0;
+        double y = -2.0 + 4.0 * (i % 512) / 511.0;
+        block[i] = static_cast<float>(2.0 * x * x * y);
+    }
+    double size = static_cast<double>(megabytes);
+
+    auto begin = chrono::steady_clock::now();
+    {
+        ofstream file(path, ios::binary);
+        for (size_t i = 0; i < megabytes; ++i)
+        {
+            file.write(reinterpret_cast<const char*>(block.data()), blockSize);
+        }
+    }
+    syncFile(path);
+    double streamSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "ofstream: " << size / streamSeconds << " MB/second" << endl;
+
+    for (bool direct : { false, true })
+    {
+        try
+        {
+            auto begin = chrono::steady_clock::now();
+            string method;
+            {
+                BulkWriter writer(path, megabytes * blockSize, direct);
+                method = writer.method();
+                for (size_t i = 0; i < megabytes; ++i)
+                {
+                    writer.write(block.data(), blockSize);
+                }
+                writer.close();
+            }
+            syncFile(path);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            cout << "BulkWriter (" << method << "): " << size / seconds << " MB/second, "
+                << streamSeconds / seconds << "x ofstream" << endl;
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to benchmark BulkWriter: " << error.what() << endl;
+        }
+    }
+
+    remove(path);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+//Writes a very large file (a grid of tens of GB) in big chunks, with many writes in flight at once.
+//The data is copied into chunks of chunkSize bytes. A full chunk is handed to the kernel and the next free chunk is
+//filled while it is written. Only when all the chunks are still being written does write() wait.
+//
+//On Linux the chunks are submitted through io_uring, set up with the system calls directly so no library is needed,
+//with up to queueDepth writes in flight. With 'direct' the file is opened with O_DIRECT: the chunks go straight to the
+//disk without a copy in the page cache, so writing tens of GB does not push everything else out of memory. The chunks
+//start at a multiple of 4096 bytes in memory and in the file, which O_DIRECT needs.
+//When io_uring can not be set up (an old kernel, or it is turned off) each chunk is written with pwrite instead, and
+//when the file system does not support O_DIRECT the file is opened without it. On Windows the chunks are written with
+//WriteFile and 'direct' is ignored.
+//
+//expectedSize is the final size of the file. The space is reserved when the file is opened, so the file system can
+//place the file in one piece. 0 reserves nothing.
+//
+//The constructor throws runtime_error when the file can not be opened, and write() and close() when a write failed
+class BulkWriter
+{
+public:
+    BulkWriter(const std::string& path, uint64_t expectedSize = 0, bool direct = false, size_t chunkSize = 1 << 20,
+        unsigned queueDepth = 16);
+    ~BulkWriter();
+
+    BulkWriter(const BulkWriter&) = delete;
+    BulkWriter& operator=(const BulkWriter&) = delete;
+
+    //Appends 'length' bytes to the file
+    void write(const void* data, size_t length);
+
+    //Writes the last chunk, waits for all the writes and closes the file
+    void close();
+
+    //How the chunks are written: "io_uring", "pwrite" or "WriteFile", and " with O_DIRECT" when the page cache is not used
+    std::string method() const;
+
+    //The number of bytes given to write()
+    uint64_t size() const { return written; }
+
+private:
+    struct Chunk;
+    struct Ring;
+
+    //Hands the chunk that is being filled to the kernel, and waits until the next chunk is free
+    void submitChunk();
+
+    //Writes the bytes of a chunk at 'offset' before returning. Returns false and sets 'failure' when it fails
+    bool writeNow(const char* data, size_t length, uint64_t offset);
+
+    //Takes the results of the finished writes from the ring. With 'wait' it waits for at least one.
+    //Returns false when waiting failed, and then it is unknown if the kernel is done with the chunks
+    bool collectCompletions(bool wait);
+
+    //Throws the first write error, if there was one
+    void throwFailure();
+
+    std::string path;
+    std::vector<char> memory;
+    std::vector<Chunk> chunks;
+    size_t current = 0;
+    size_t chunkSize;
+    uint64_t written = 0;
+    uint64_t nextOffset = 0;
+    bool directIo = false;
+    bool closed = false;
+    std::string failure;
+    std::unique_ptr<Ring> ring;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
+
+//Writes 'megabytes' MB with ofstream, with BulkWriter and with BulkWriter and O_DIRECT, and prints the MB/second of each.
+//The time includes getting the data to the disk, not only into the page cache. The file is deleted afterwards
+void benchmarkBulkWriter(size_t megabytes);
@@ -0,0 +1,417 @@
+#include "DataText.h"
+#include "MappedFile.h"
+#include "TextWriter.h"
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cfloat>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define DATA_TEXT_SSE2 1
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+namespace
+{
+    const char headerText[] = "Number of lines: ";
+
+    //How the old Oppgave 1 wrote y and the derivative: both names first, and then the two numbers with nothing between
+    const char legacyText[] = " y:  derivative: ";
+
+    //The text is parsed in blocks of about this many bytes, one block for each task
+    const size_t blockSize = 1 << 20;
+
+    //A part of the text that ends at a line break, and the rows its lines go to
+    struct Block
+    {
+        const char* begin;
+        const char* end;
+        size_t rowCount;
+        size_t firstRow;
+        //Empty, or what was wrong with a line in the block
+        string error;
+    };
+
+    //Counts the '\n' in text[0..length)
+    size_t countLines(const char* text, size_t length)
+    {
+        size_t count = 0;
+        size_t i = 0;
+#ifdef DATA_TEXT_SSE2
+        const __m128i newline = _mm_set1_epi8('\n');
+        while (length - i >= 16)
+        {
+            //Each byte of 'counts' counts the line breaks at its position in 16 bytes. They are added up before a
+            //byte can overflow, after 255 steps
+            __m128i counts = _mm_setzero_si128();
+            size_t steps = min<size_t>((length - i) / 16, 255);
+            for (size_t s = 0; s < steps; ++s, i += 16)
+            {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+                //The compare gives -1 in the bytes that are '\n', so subtracting it adds one
+                counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(bytes, newline));
+            }
+            //Adds the 16 byte counts into two 64-bit sums
+            __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+            count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums));
+        }
+#endif
+        for (; i < length; ++i)
+        {
+            count += text[i] == '\n';
+        }
+        return count;
+    }
+
+    //The powers of ten that a double holds exactly
+    const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    //Reads a number in the same way as from_chars. Most numbers in the files have at most 19 digits and a small
+    //exponent, and are then calculated from the digits with one double multiplication or division. The digits and the
+    //power of ten are exact in a double, so that gives the correctly rounded double. Rounding it to float gives the same
+    //float as from_chars, since every point halfway between two floats is a double as well, except when the double is
+    //exactly on such a point. Those numbers, and all the unusual ones, are read by from_chars.
+    //Returns where the number ends, or nullptr when there is no number
+    const char* readFloat(const char* p, const char* end, float& value)
+    {
+        const char* begin = p;
+        bool negative = p < end && *p == '-';
+        if (negative)
+        {
+            ++p;
+        }
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int exponent = 0;
+        while (p < end && static_cast<unsigned>(*p - '0') < 10)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            ++digits;
+            ++p;
+        }
+        if (p < end && *p == '.')
+        {
+            ++p;
+            while (p < end && static_cast<unsigned>(*p - '0') < 10)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                ++digits;
+                --exponent;
+                ++p;
+            }
+        }
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            bool negativeExponent = p < end && *p == '-';
+            if (p < end && (*p == '-' || *p == '+'))
+            {
+                ++p;
+            }
+            int written = 0;
+            int exponentDigits = 0;
+            while (p < end && static_cast<unsigned>(*p - '0') < 10 && exponentDigits < 4)
+            {
+                written = written * 10 + (*p - '0');
+                ++exponentDigits;
+                ++p;
+            }
+            if (exponentDigits == 0 || exponentDigits == 4)
+            {
+                digits = 0;
+            }
+            exponent += negativeExponent ? -written : written;
+        }
+
+        if (digits > 0 && digits <= 19 && mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+        {
+            double result = static_cast<double>(mantissa);
+            result = exponent < 0 ? result / powersOfTen[-exponent] : result * powersOfTen[exponent];
+            //A double between the smallest and the largest normal float is halfway between two floats when the 29 bits
+            //that are rounded away are 1000...0
+            uint64_t bits;
+            memcpy(&bits, &result, sizeof(bits));
+            bool halfway = (bits & ((uint64_t(1) << 29) - 1)) == (uint64_t(1) << 28);
+            if (result == 0.0 || (result >= FLT_MIN && result <= FLT_MAX && !halfway))
+            {
+                value = static_cast<float>(negative ? -result : result);
+                return p;
+            }
+        }
+
+        from_chars_result result = from_chars(begin, end, value);
+        return result.ec == errc() ? result.ptr : nullptr;
+    }
+
+    //The names of the fields on the first line, for example x, y, z, red, green, blue
+    vector<string> readNames(const char* p, const char* end)
+    {
+        vector<string> names;
+        const char* lineEnd = find(p, end, '\n');
+        while (p < lineEnd)
+        {
+            const char* colon = find(p, lineEnd, ':');
+            if (colon == lineEnd)
+            {
+                break;
+            }
+            names.emplace_back(p, colon);
+            //Skips ": " and the value
+            p = find(min(colon + 2, lineEnd), lineEnd, ' ');
+            if (p < lineEnd)
+            {
+                ++p;
+            }
+        }
+        return names;
+    }
+
+    //Parses the lines of the block into the columns. 'firstLine' is the line number of row 0 in the file
+    void parseBlock(Block& block, const vector<string>& names, vector<vector<float>>& columns, size_t firstLine)
+    {
+        const char* p = block.begin;
+        const char* end = block.end;
+        size_t row = block.firstRow;
+        auto fail = [&](const string& message)
+        {
+            block.error = "Line " + to_string(firstLine + row) + ": " + message;
+        };
+
+        while (p < end)
+        {
+            for (size_t c = 0; c < names.size(); ++c)
+            {
+                const string& name = names[c];
+                if (c > 0)
+                {
+                    if (*p != ' ')
+                    {
+                        return fail("expected a space before " + name);
+                    }
+                    ++p;
+                }
+                if (static_cast<size_t>(end - p) < name.size() + 2 || memcmp(p, name.data(), name.size()) != 0 ||
+                    p[name.size()] != ':' || p[name.size() + 1] != ' ')
+                {
+                    return fail("expected '" + name + ": '");
+                }
+                p += name.size() + 2;
+
+                float value;
+                const char* numberEnd = readFloat(p, end, value);
+                if (numberEnd == nullptr)
+                {
+                    return fail("the value of " + name + " is not a number");
+                }
+                columns[c][row] = value;
+                p = numberEnd;
+            }
+
+            //The files can have Windows line breaks when they have been copied around
+            if (p < end && *p == '\r')
+            {
+                ++p;
+            }
+            if (p < end)
+            {
+                if (*p != '\n')
+                {
+                    return fail("more fields than on the first line");
+                }
+                ++p;
+            }
+            ++row;
+        }
+    }
+}
+
+const vector<float>* DataTable::column(const string& name) const
+{
+    for (size_t c = 0; c < columnNames.size(); ++c)
+    {
+        if (columnNames[c] == name)
+        {
+            return &columns[c];
+        }
+    }
+    return nullptr;
+}
+
+DataTable parseDataText(const char* text, size_t length, ThreadPool& pool)
+{
+    DataTable table;
+    const char* p = text;
+    const char* end = text + length;
+
+    //The Oppgave3 header line
+    bool hasHeader = length >= sizeof(headerText) - 1 && memcmp(text, headerText, sizeof(headerText) - 1) == 0;
+    size_t headerCount = 0;
+    if (hasHeader)
+    {
+        p += sizeof(headerText) - 1;
+        from_chars_result result = from_chars(p, end, headerCount);
+        if (result.ec != errc())
+        {
+            throw runtime_error("Line 1: the number of lines is not a number");
+        }
+        p = find(result.ptr, end, '\n');
+        p = p == end ? end : p + 1;
+    }
+    if (p == end)
+    {
+        return table;
+    }
+
+    //An old Oppgave 1 line is "x: -1.9 y:  derivative: -3.793.61 ...". The glued -3.793.61 can be -3.79 and 3.61 or
+    //-3.7 and 93.61, and both are numbers the program could have written, so the file is rejected instead of guessed
+    const char* firstLineEnd = find(p, end, '\n');
+    if (search(p, firstLineEnd, legacyText, legacyText + sizeof(legacyText) - 1) != firstLineEnd)
+    {
+        throw runtime_error("Line " + to_string(hasHeader ? 2 : 1) + ": the legacy Oppgave 1 format, where y is glued "
+            "onto the derivative, is not supported. Run Oppgave 1 again to write the file in the current format");
+    }
+
+    table.columnNames = readNames(p, end);
+    if (table.columnNames.empty())
+    {
+        throw runtime_error("Line " + to_string(hasHeader ? 2 : 1) + ": there are no 'name: value' fields");
+    }
+    table.columns.resize(table.columnNames.size());
+    if (hasHeader)
+    {
+        for (vector<float>& column : table.columns)
+        {
+            column.resize(headerCount);
+        }
+    }
+
+    //Splits the text after a line break every blockSize bytes
+    vector<Block> blocks;
+    while (p < end)
+    {
+        const char* blockEnd = p + min<size_t>(blockSize, end - p);
+        if (blockEnd < end)
+        {
+            const void* lineBreak = memchr(blockEnd, '\n', end - blockEnd);
+            blockEnd = lineBreak ? static_cast<const char*>(lineBreak) + 1 : end;
+        }
+        blocks.push_back({ p, blockEnd, 0, 0, string() });
+        p = blockEnd;
+    }
+
+    pool.parallelFor(blocks.size(), [&](size_t i)
+    {
+        blocks[i].rowCount = countLines(blocks[i].begin, blocks[i].end - blocks[i].begin);
+    });
+    //The last line does not need a line break
+    if (end[-1] != '\n')
+    {
+        ++blocks.back().rowCount;
+    }
+    size_t rowCount = 0;
+    for (Block& block : blocks)
+    {
+        block.firstRow = rowCount;
+        rowCount += block.rowCount;
+    }
+
+    if (!hasHeader)
+    {
+        for (vector<float>& column : table.columns)
+        {
+            column.resize(rowCount);
+        }
+    }
+    else if (rowCount != headerCount)
+    {
+        throw runtime_error("The header says there are " + to_string(headerCount) + " lines, but there are " +
+            to_string(rowCount));
+    }
+
+    size_t firstLine = hasHeader ? 2 : 1;
+    pool.parallelFor(blocks.size(), [&](size_t i)
+    {
+        parseBlock(blocks[i], table.columnNames, table.columns, firstLine);
+    });
+    for (const Block& block : blocks)
+    {
+        if (!block.error.empty())
+        {
+            throw runtime_error(block.error);
+        }
+    }
+    return table;
+}
+
+DataTable readDataText(const string& path, ThreadPool& pool)
+{
+    MappedFile file(path);
+    return parseDataText(file.data(), file.size(), pool);
+}
+
+void benchmarkDataText(size_t numberOfLines, ThreadPool& pool)
+{
+    const char* path = "DataTextBenchmark.txt";
+    {
+        TextWriter writer(path);
+        writer << "Number of lines: " << numberOfLines << '\n';
+        for (size_t i = 0; i < numberOfLines; ++i)
+        {
+            double x = -2.0 + 4.0 * (i / 1000) / 999.0;
+            double y = -2.0 + 4.0 * (i % 1000) / 999.0;
+            double color = max(0.0, min(1.0, (x + 1.0) / 2.0));
+            writer << "x: " << x << " y: " << y << " z: " << 2.0 * x * x * y <<
+                " red: " << color << " green: " << color << " blue: " << color << '\n';
+        }
+    }
+
+    //Reads the same lines with ifstream, one word and one number at a time
+    auto begin = chrono::steady_clock::now();
+    double checksum = 0.0;
+    {
+        ifstream stream(path);
+        string word;
+        float value;
+        stream >> word >> word >> word >> value;
+        while (stream >> word >> value)
+        {
+            checksum += value;
+        }
+    }
+    double streamSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    double megabytes, oneThreadSeconds, poolSeconds;
+    {
+        MappedFile file(path);
+        megabytes = file.size() / (1024.0 * 1024.0);
+
+        ThreadPool onePool(1);
+        begin = chrono::steady_clock::now();
+        DataTable table = parseDataText(file.data(), file.size(), onePool);
+        oneThreadSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        checksum += table.columns[2][numberOfLines / 3];
+
+        begin = chrono::steady_clock::now();
+        table = parseDataText(file.data(), file.size(), pool);
+        poolSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        checksum += table.columns[2][numberOfLines / 3];
+    }
+    //The file can only be deleted when it is no longer mapped
+    remove(path);
+
+    cout << "Reading " << megabytes << " MB of Data.txt with ifstream: " << megabytes / streamSeconds << " MB/second" << endl;
+    cout << "parseDataText on one thread: " << megabytes / oneThreadSeconds << " MB/second, "
+        << streamSeconds / oneThreadSeconds << "x faster" << endl;
+    cout << "parseDataText on " << pool.size() << " threads: " << megabytes / poolSeconds << " MB/second, "
+        << oneThreadSeconds / poolSeconds << "x one thread" << endl;
+    cout << "Checksum: " << checksum << endl;
+}
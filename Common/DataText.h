@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "ThreadPool.h"
+
+//The points of a Data.txt file with one array for each field, for example x, y, z, red, green and blue.
+//The arrays can be given to glBufferData one after the other without changing them
+struct DataTable
+{
+    std::vector<std::string> columnNames;
+    std::vector<std::vector<float>> columns;
+
+    size_t rowCount() const { return columns.empty() ? 0 : columns[0].size(); }
+
+    //The values of the column with the name, or nullptr when there is none
+    const std::vector<float>* column(const std::string& name) const;
+};
+
+//Reads the text that the three programs write to Data.txt. Every line is "name: value name: value ...", with the same
+//names on every line, and the Oppgave3 file starts with "Number of lines: N". The names are taken from the first line.
+//Oppgave 1 files from before y was written in its own field ("y:  derivative: -3.793.61") are not supported, since the
+//glued numbers can be split in more than one way. They throw runtime_error that says so.
+//
+//The text is split into blocks that end at a line break. The lines in each block are counted with SSE2 (16 bytes at a
+//time), which gives the first row of every block, and then the blocks are parsed on all the threads of the pool
+//straight into their rows of the arrays. The numbers are read with a short fast path that gives exactly the same float
+//as std::from_chars, which reads the rest.
+//The arrays are allocated once, from the count in the header when there is one.
+//
+//Throws runtime_error with the line number when a line does not match the first one, and when the header count is wrong
+DataTable parseDataText(const char* text, size_t length, ThreadPool& pool);
+
+//Maps the file and parses it. Throws runtime_error when the file can not be read
+DataTable readDataText(const std::string& path, ThreadPool& pool);
+
+//Writes 'numberOfLines' lines in the format of the Oppgave3 Data.txt, parses them on one thread and on the pool, and
+//prints the speed in MB/second. The file is deleted afterwards
+void benchmarkDataText(size_t numberOfLines, ThreadPool& pool);
@@ -0,0 +1,230 @@
+#include "Dataset.h"
+#include "BulkWriter.h"
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+using namespace std;
+
+namespace
+{
+    const char magic[4] = { 'S', 'D', 'A', 'T' };
+
+    //Copies a number into the byte array. The programs only run on little-endian processors (x86 and ARM), so the
+    //bytes in memory are already in the order of the file
+    template<typename T>
+    void put(vector<char>& bytes, size_t offset, T value)
+    {
+        memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    template<typename T>
+    T get(const char* bytes, size_t offset)
+    {
+        T value;
+        memcpy(&value, bytes + offset, sizeof(T));
+        return value;
+    }
+}
+
+uint64_t DatasetHeader::columnOffset(size_t index) const
+{
+    return datasetHeaderSize + columnNames.size() * datasetColumnNameSize + index * pointCount * sizeof(float);
+}
+
+int DatasetHeader::findColumn(const string& name) const
+{
+    for (size_t c = 0; c < columnNames.size(); ++c)
+    {
+        if (columnNames[c] == name)
+        {
+            return static_cast<int>(c);
+        }
+    }
+    return -1;
+}
+
+void writeDataset(const string& path, const DatasetHeader& header, const vector<const float*>& columns, bool bulk)
+{
+    if (columns.size() != header.columnNames.size())
+    {
+        throw runtime_error("The dataset has " + to_string(header.columnNames.size()) + " column names but " +
+            to_string(columns.size()) + " columns");
+    }
+
+    vector<char> bytes(datasetHeaderSize + header.columnNames.size() * datasetColumnNameSize, 0);
+    memcpy(bytes.data(), magic, sizeof(magic));
+    put(bytes, 4, datasetVersion);
+    put(bytes, 8, static_cast<uint32_t>(header.function));
+    put(bytes, 12, static_cast<uint32_t>(header.columnNames.size()));
+    put(bytes, 16, header.pointCount);
+    put(bytes, 24, header.countX);
+    put(bytes, 28, header.countY);
+    put(bytes, 32, header.domainMinimumX);
+    put(bytes, 40, header.domainMaximumX);
+    put(bytes, 48, header.domainMinimumY);
+    put(bytes, 56, header.domainMaximumY);
+    for (size_t c = 0; c < header.columnNames.size(); ++c)
+    {
+        const string& name = header.columnNames[c];
+        if (name.size() >= datasetColumnNameSize)
+        {
+            throw runtime_error("The column name " + name + " is too long");
+        }
+        memcpy(bytes.data() + datasetHeaderSize + c * datasetColumnNameSize, name.data(), name.size());
+    }
+
+    size_t columnSize = header.pointCount * sizeof(float);
+    if (bulk)
+    {
+        BulkWriter file(path, bytes.size() + columns.size() * columnSize, true);
+        file.write(bytes.data(), bytes.size());
+        for (const float* column : columns)
+        {
+            file.write(column, columnSize);
+        }
+        file.close();
+        return;
+    }
+
+    ofstream file(path, ios::binary);
+    if (!file)
+    {
+        throw runtime_error("Could not open " + path + " for writing");
+    }
+    file.write(bytes.data(), bytes.size());
+    for (const float* column : columns)
+    {
+        file.write(reinterpret_cast<const char*>(column), static_cast<streamsize>(columnSize));
+    }
+    if (!file)
+    {
+        throw runtime_error("Could not write " + path);
+    }
+}
+
+namespace
+{
+    //Throws runtime_error when a file of 'fileSize' bytes is too short for the column names and all the columns the
+    //header promises. It is checked before anything is allocated from the numbers in the header, so a damaged file
+    //ends in a runtime_error and not in bad_alloc
+    void checkDatasetSize(uint32_t columnCount, uint64_t pointCount, uint64_t fileSize, const string& path)
+    {
+        if (columnCount == 0)
+        {
+            throw runtime_error(path + " has no columns");
+        }
+        uint64_t namesEnd = datasetHeaderSize + static_cast<uint64_t>(columnCount) * datasetColumnNameSize;
+        if (fileSize < namesEnd)
+        {
+            throw runtime_error(path + " ends inside the header");
+        }
+        //Divides instead of multiplying, so a very large pointCount can not overflow
+        if (pointCount > (fileSize - namesEnd) / sizeof(float) / columnCount)
+        {
+            throw runtime_error(path + " is too short for " + to_string(columnCount) + " columns of " +
+                to_string(pointCount) + " points");
+        }
+    }
+
+    //Reads the header from the first 'size' bytes. The whole file is 'fileSize' bytes
+    DatasetHeader parseDatasetHeader(const char* bytes, size_t size, uint64_t fileSize, const string& path)
+    {
+        if (size < datasetHeaderSize || memcmp(bytes, magic, sizeof(magic)) != 0)
+        {
+            throw runtime_error(path + " is not a dataset file");
+        }
+        uint32_t version = get<uint32_t>(bytes, 4);
+        if (version != datasetVersion)
+        {
+            throw runtime_error(path + " has dataset version " + to_string(version) + ", only version " +
+                to_string(datasetVersion) + " can be read");
+        }
+
+        DatasetHeader header;
+        header.function = static_cast<DatasetFunction>(get<uint32_t>(bytes, 8));
+        uint32_t columnCount = get<uint32_t>(bytes, 12);
+        header.pointCount = get<uint64_t>(bytes, 16);
+        header.countX = get<uint32_t>(bytes, 24);
+        header.countY = get<uint32_t>(bytes, 28);
+        header.domainMinimumX = get<double>(bytes, 32);
+        header.domainMaximumX = get<double>(bytes, 40);
+        header.domainMinimumY = get<double>(bytes, 48);
+        header.domainMaximumY = get<double>(bytes, 56);
+
+        checkDatasetSize(columnCount, header.pointCount, fileSize, path);
+        if (size < datasetHeaderSize + columnCount * datasetColumnNameSize)
+        {
+            throw runtime_error(path + " ends inside the header");
+        }
+        for (uint32_t c = 0; c < columnCount; ++c)
+        {
+            const char* name = bytes + datasetHeaderSize + c * datasetColumnNameSize;
+            header.columnNames.push_back(string(name, strnlen(name, datasetColumnNameSize)));
+        }
+        return header;
+    }
+}
+
+DatasetHeader readDatasetHeader(const char* bytes, size_t size, const string& path)
+{
+    return parseDatasetHeader(bytes, size, size, path);
+}
+
+DatasetHeader readDatasetHeader(const string& path)
+{
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file)
+    {
+        throw runtime_error("Could not open " + path);
+    }
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    //Reads the fixed part first to find the number of column names
+    vector<char> bytes(datasetHeaderSize);
+    file.read(bytes.data(), bytes.size());
+    if (!file || memcmp(bytes.data(), magic, sizeof(magic)) != 0 || get<uint32_t>(bytes.data(), 4) != datasetVersion)
+    {
+        //Throws the message for a file that is not a dataset or has another version
+        return parseDatasetHeader(bytes.data(), file ? bytes.size() : 0, fileSize, path);
+    }
+    uint32_t columnCount = get<uint32_t>(bytes.data(), 12);
+    checkDatasetSize(columnCount, get<uint64_t>(bytes.data(), 16), fileSize, path);
+    bytes.resize(datasetHeaderSize + columnCount * datasetColumnNameSize);
+    file.read(bytes.data() + datasetHeaderSize, bytes.size() - datasetHeaderSize);
+    return parseDatasetHeader(bytes.data(), file ? bytes.size() : datasetHeaderSize, fileSize, path);
+}
+
+const float* datasetColumn(const MappedFile& file, const DatasetHeader& header, const string& name)
+{
+    int index = header.findColumn(name);
+    if (index < 0)
+    {
+        throw runtime_error("The dataset has no column called " + name);
+    }
+    if (file.size() < header.columnOffset(header.columnNames.size()))
+    {
+        throw runtime_error("The dataset ends before the last column");
+    }
+    return reinterpret_cast<const float*>(file.data() + header.columnOffset(index));
+}
+
+vector<float> readDatasetColumn(const string& path, const string& name)
+{
+    DatasetHeader header = readDatasetHeader(path);
+    int index = header.findColumn(name);
+    if (index < 0)
+    {
+        throw runtime_error(path + " has no column called " + name);
+    }
+
+    ifstream file(path, ios::binary);
+    file.seekg(static_cast<streamoff>(header.columnOffset(index)));
+    vector<float> values(header.pointCount);
+    file.read(reinterpret_cast<char*>(values.data()), static_cast<streamsize>(values.size() * sizeof(float)));
+    if (!file)
+    {
+        throw runtime_error(path + " ends inside the column " + name);
+    }
+    return values;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "MappedFile.h"
+
+//Which function a dataset was sampled from
+enum class DatasetFunction : uint32_t
+{
+    Expression = 0, //A function given as text
+    Curve = 1, //Oppgave 1: f(x) = x^2
+    Spiral = 2, //Oppgave 2: the spiral (a t cos(t), a t sin(t), b t)
+    Surface = 3 //Oppgave 3: f(x, y) = 2x^2y
+};
+
+//The binary dataset file (.bin) stores the same points as Data.txt, but as floats column after column.
+//A program that only needs z can then read the z column without touching x, y or the colors.
+//
+//Layout, all numbers little-endian:
+//  offset  0  char[4]   "SDAT"
+//  offset  4  uint32    version (datasetVersion)
+//  offset  8  uint32    DatasetFunction
+//  offset 12  uint32    number of columns
+//  offset 16  uint64    number of points
+//  offset 24  uint32    countX, the number of points along x (along t for the spiral)
+//  offset 28  uint32    countY, the number of points along y (1 for a curve)
+//  offset 32  double[4] the domain: smallest x, largest x, smallest y, largest y
+//  offset 64  char[16]  the name of every column, padded with zeros
+//  then one float column with 'number of points' values for each name, in the same order
+const uint32_t datasetVersion = 1;
+
+struct DatasetHeader
+{
+    DatasetFunction function = DatasetFunction::Expression;
+    uint64_t pointCount = 0;
+    uint32_t countX = 0;
+    uint32_t countY = 1;
+    double domainMinimumX = 0.0;
+    double domainMaximumX = 0.0;
+    double domainMinimumY = 0.0;
+    double domainMaximumY = 0.0;
+    std::vector<std::string> columnNames;
+
+    //The number of bytes from the start of the file to the first value of column 'index'
+    uint64_t columnOffset(size_t index) const;
+
+    //The index of the column with the name, or -1 when there is none
+    int findColumn(const std::string& name) const;
+};
+
+//The size of the fixed part of the header and of one column name
+const size_t datasetHeaderSize = 64;
+const size_t datasetColumnNameSize = 16;
+
+//Writes the header and the columns. columns[c] points to header.pointCount floats for column c.
+//With 'bulk' the file is written with a BulkWriter and O_DIRECT, for grids that are too large for the page cache.
+//Throws runtime_error when the file can not be written
+void writeDataset(const std::string& path, const DatasetHeader& header, const std::vector<const float*>& columns,
+    bool bulk = false);
+
+//Reads the header only. Throws runtime_error when the file is missing, is not a dataset of a known version or is
+//shorter than the columns the header promises
+DatasetHeader readDatasetHeader(const std::string& path);
+
+//Reads the header of a whole dataset of 'size' bytes that is already in memory, for example a MappedFile, with the
+//same checks. 'path' is only used in the error messages
+DatasetHeader readDatasetHeader(const char* bytes, size_t size, const std::string& path);
+
+//The values of one column of a mapped dataset, straight from the mapped file without a copy.
+//Throws runtime_error when there is no column with that name or the file is shorter than the header says
+const float* datasetColumn(const MappedFile& file, const DatasetHeader& header, const std::string& name);
+
+//Reads one column by seeking straight to it. Throws runtime_error when there is no column with that name
+std::vector<float> readDatasetColumn(const std::string& path, const std::string& name);
@@ -0,0 +1,255 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+
+//A dual number holds a value together with its derivative (or gradient when there are N variables).
+//When a function template is evaluated with Dual instead of double, every operation also applies the rules of
+//differentiation, so one evaluation gives the value and the exact derivative without the error of a fixed h.
+//T is normally double, but any type with the same arithmetic operators works. With one of the SIMD types in
+//SimdDouble.h one evaluation handles several points at once
+template<typename T, int N = 1>
+struct Dual
+{
+    T value;
+    T gradient[N];
+
+    //A constant has the derivative 0 with respect to every variable
+    static Dual constant(T value)
+    {
+        Dual result;
+        result.value = value;
+        for (int i = 0; i < N; ++i)
+        {
+            result.gradient[i] = T{};
+        }
+        return result;
+    }
+
+    //The variable number 'index' has the derivative 1 with respect to itself and 0 with respect to the others
+    static Dual variable(T value, int index = 0)
+    {
+        Dual result = constant(value);
+        result.gradient[index] = result.gradient[index] + 1.0;
+        return result;
+    }
+
+    //The derivative with respect to the first variable
+    T derivative() const
+    {
+        return gradient[0];
+    }
+};
+
+//x^n for an integer n. Doubles use pow so the value is the same as in the plain function,
+//other types multiply n times. A negative n gives 1 / x^-n
+inline double integerPower(double x, int n)
+{
+    return std::pow(x, n);
+}
+
+template<typename T>
+T integerPower(T x, int n)
+{
+    T result = T{} + 1.0;
+    for (int i = 0; i < n || i < -n; ++i)
+    {
+        result = result * x;
+    }
+    return n < 0 ? (T{} + 1.0) / result : result;
+}
+
+//Calls f for each double in x. T is double, or a type that is made of doubles only, like the SIMD types in
+//SimdDouble.h. It is used for the standard functions that only take a double
+template<typename T, typename F>
+T eachDouble(T x, F f)
+{
+    static_assert(sizeof(T) % sizeof(double) == 0, "eachDouble needs a type that is made of doubles");
+    double lanes[sizeof(T) / sizeof(double)];
+    memcpy(lanes, &x, sizeof(T));
+    for (double& lane : lanes)
+    {
+        lane = f(lane);
+    }
+    memcpy(&x, lanes, sizeof(T));
+    return x;
+}
+
+//x^p for a p that is not a whole number
+template<typename T>
+T realPower(T x, double p)
+{
+    return eachDouble(x, [p](double v) { return std::pow(v, p); });
+}
+
+template<typename T, int N>
+Dual<T, N> operator+(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+    Dual<T, N> result;
+    result.value = a.value + b.value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = a.gradient[i] + b.gradient[i];
+    }
+    return result;
+}
+
+template<typename T, int N>
+Dual<T, N> operator-(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+    Dual<T, N> result;
+    result.value = a.value - b.value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = a.gradient[i] - b.gradient[i];
+    }
+    return result;
+}
+
+template<typename T, int N>
+Dual<T, N> operator-(const Dual<T, N>& a)
+{
+    Dual<T, N> result;
+    result.value = -a.value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = -a.gradient[i];
+    }
+    return result;
+}
+
+//Product rule: (ab)' = a'b + ab'
+template<typename T, int N>
+Dual<T, N> operator*(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+    Dual<T, N> result;
+    result.value = a.value * b.value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = a.gradient[i] * b.value + a.value * b.gradient[i];
+    }
+    return result;
+}
+
+//Quotient rule: (a/b)' = (a'b - ab') / b^2
+template<typename T, int N>
+Dual<T, N> operator/(const Dual<T, N>& a, const Dual<T, N>& b)
+{
+    Dual<T, N> result;
+    result.value = a.value / b.value;
+    T denominator = b.value * b.value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = (a.gradient[i] * b.value - a.value * b.gradient[i]) / denominator;
+    }
+    return result;
+}
+
+//Operators with a plain number on one side, so functions can be written as 2.0 * pow(x, 2) * y
+template<typename T, int N>
+Dual<T, N> operator+(const Dual<T, N>& a, double b) { return a + Dual<T, N>::constant(T{} + b); }
+template<typename T, int N>
+Dual<T, N> operator+(double a, const Dual<T, N>& b) { return b + a; }
+template<typename T, int N>
+Dual<T, N> operator-(const Dual<T, N>& a, double b) { return a + (-b); }
+template<typename T, int N>
+Dual<T, N> operator-(double a, const Dual<T, N>& b) { return -b + a; }
+
+template<typename T, int N>
+Dual<T, N> operator*(const Dual<T, N>& a, double b)
+{
+    Dual<T, N> result;
+    result.value = a.value * b;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = a.gradient[i] * b;
+    }
+    return result;
+}
+
+template<typename T, int N>
+Dual<T, N> operator*(double a, const Dual<T, N>& b) { return b * a; }
+template<typename T, int N>
+Dual<T, N> operator/(const Dual<T, N>& a, double b) { return a * (1.0 / b); }
+template<typename T, int N>
+Dual<T, N> operator/(double a, const Dual<T, N>& b) { return Dual<T, N>::constant(T{} + a) / b; }
+
+//Power rule: (x^n)' = n x^(n-1) x'
+template<typename T, int N>
+Dual<T, N> pow(const Dual<T, N>& x, int n)
+{
+    Dual<T, N> result;
+    result.value = integerPower(x.value, n);
+    T factor = T{};
+    if (n != 0)
+    {
+        factor = integerPower(x.value, n - 1) * static_cast<double>(n);
+    }
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = factor * x.gradient[i];
+    }
+    return result;
+}
+
+//Power rule for a p that is not a whole number: (x^p)' = p x^(p-1) x'. pow(x, 2) still uses the integer version
+//above, since 2 is an int
+template<typename T, int N>
+Dual<T, N> pow(const Dual<T, N>& x, double p)
+{
+    Dual<T, N> result;
+    result.value = realPower(x.value, p);
+    T factor = realPower(x.value, p - 1.0) * p;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = factor * x.gradient[i];
+    }
+    return result;
+}
+
+//The chain rule for the most common functions. They work for every T that eachDouble() takes, so function(x) can use
+//them with Dual<double> and with Dual<Double4>
+template<typename T, int N>
+Dual<T, N> applyChainRule(const Dual<T, N>& x, T value, T derivative)
+{
+    Dual<T, N> result;
+    result.value = value;
+    for (int i = 0; i < N; ++i)
+    {
+        result.gradient[i] = derivative * x.gradient[i];
+    }
+    return result;
+}
+
+template<typename T, int N>
+Dual<T, N> sqrt(const Dual<T, N>& x)
+{
+    T root = eachDouble(x.value, [](double v) { return std::sqrt(v); });
+    return applyChainRule(x, root, 0.5 / root);
+}
+
+template<typename T, int N>
+Dual<T, N> exp(const Dual<T, N>& x)
+{
+    T e = eachDouble(x.value, [](double v) { return std::exp(v); });
+    return applyChainRule(x, e, e);
+}
+
+template<typename T, int N>
+Dual<T, N> log(const Dual<T, N>& x)
+{
+    return applyChainRule(x, eachDouble(x.value, [](double v) { return std::log(v); }), 1.0 / x.value);
+}
+
+template<typename T, int N>
+Dual<T, N> sin(const Dual<T, N>& x)
+{
+    return applyChainRule(x, eachDouble(x.value, [](double v) { return std::sin(v); }),
+        eachDouble(x.value, [](double v) { return std::cos(v); }));
+}
+
+template<typename T, int N>
+Dual<T, N> cos(const Dual<T, N>& x)
+{
+    return applyChainRule(x, eachDouble(x.value, [](double v) { return std::cos(v); }),
+        -eachDouble(x.value, [](double v) { return std::sin(v); }));
+}
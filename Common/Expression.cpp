@@ -0,0 +1,653 @@
+#include "Expression.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <stdexcept>
+#include <algorithm>
+using namespace std;
+
+namespace
+{
+    //A node in the syntax tree that the parser builds before the bytecode is made
+    struct Node
+    {
+        enum Kind { Constant, Variable, Unary, Binary, IntegerPower };
+        Kind kind;
+        OpCode op;
+        double value; //The value of a Constant
+        int index; //The variable number of a Variable, or the exponent of an IntegerPower
+        int left;
+        int right;
+    };
+
+    //Calculates one operation on plain numbers. Used both for constant folding and by the virtual machine
+    double apply(OpCode op, double a, double b)
+    {
+        switch (op)
+        {
+        case OpCode::Add: return a + b;
+        case OpCode::Subtract: return a - b;
+        case OpCode::Multiply: return a * b;
+        case OpCode::Divide: return a / b;
+        case OpCode::Negate: return -a;
+        case OpCode::Abs: return fabs(a);
+        case OpCode::Sqrt: return sqrt(a);
+        case OpCode::Min: return min(a, b);
+        case OpCode::Max: return max(a, b);
+        case OpCode::Power: return pow(a, b);
+        case OpCode::Sin: return sin(a);
+        case OpCode::Cos: return cos(a);
+        case OpCode::Tan: return tan(a);
+        case OpCode::Exp: return exp(a);
+        case OpCode::Log: return log(a);
+        }
+        return 0.0;
+    }
+
+    //Integer exponents up to this size are calculated with multiplications instead of pow
+    const int largestIntegerPower = 64;
+
+    //A recursive descent parser for the grammar
+    //  expression = term { ("+" | "-") term }
+    //  term       = unary { ("*" | "/") unary }
+    //  unary      = ("-" | "+") unary | power
+    //  power      = primary [ "^" unary ]
+    //  primary    = number | name | name "(" expression { "," expression } ")" | "(" expression ")"
+    //Every node is folded as soon as it is made, so constant parts never reach the bytecode
+    class Parser
+    {
+    public:
+        Parser(const string& source, const vector<string>& variableNames, const vector<pair<string, double>>& parameters)
+            : text(source), variables(variableNames), parameters(parameters), position(0)
+        {
+        }
+
+        vector<Node> nodes;
+
+        int parse()
+        {
+            int root = parseExpression();
+            skipSpaces();
+            if (position < text.size())
+            {
+                fail("unexpected '" + string(1, text[position]) + "'");
+            }
+            return root;
+        }
+
+    private:
+        const string& text;
+        const vector<string>& variables;
+        const vector<pair<string, double>>& parameters;
+        size_t position;
+
+        [[noreturn]] void fail(const string& message) const
+        {
+            throw runtime_error("Expression error at position " + to_string(position) + ": " + message);
+        }
+
+        void skipSpaces()
+        {
+            while (position < text.size() && isspace(static_cast<unsigned char>(text[position])))
+            {
+                ++position;
+            }
+        }
+
+        bool accept(char c)
+        {
+            skipSpaces();
+            if (position < text.size() && text[position] == c)
+            {
+                ++position;
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            if (!accept(c))
+            {
+                fail(string("expected '") + c + "'");
+            }
+        }
+
+        bool isConstant(int node) const { return nodes[node].kind == Node::Constant; }
+        bool isConstant(int node, double value) const { return isConstant(node) && nodes[node].value == value; }
+
+        int addNode(const Node& node)
+        {
+            nodes.push_back(node);
+            return static_cast<int>(nodes.size()) - 1;
+        }
+
+        int constant(double value)
+        {
+            return addNode({ Node::Constant, OpCode::Add, value, 0, -1, -1 });
+        }
+
+        int unary(OpCode op, int operand)
+        {
+            if (isConstant(operand))
+            {
+                return constant(apply(op, nodes[operand].value, 0.0));
+            }
+            return addNode({ Node::Unary, op, 0.0, 0, operand, -1 });
+        }
+
+        int binary(OpCode op, int left, int right)
+        {
+            if (isConstant(left) && isConstant(right))
+            {
+                return constant(apply(op, nodes[left].value, nodes[right].value));
+            }
+
+            //Removes the operations that do not change the value: x+0, 0+x, x-0, x*1, 1*x and x/1
+            if ((op == OpCode::Add && isConstant(right, 0.0)) || (op == OpCode::Subtract && isConstant(right, 0.0)) ||
+                (op == OpCode::Multiply && isConstant(right, 1.0)) || (op == OpCode::Divide && isConstant(right, 1.0)))
+            {
+                return left;
+            }
+            if ((op == OpCode::Add && isConstant(left, 0.0)) || (op == OpCode::Multiply && isConstant(left, 1.0)))
+            {
+                return right;
+            }
+
+            if (op == OpCode::Power && isConstant(right))
+            {
+                double exponent = nodes[right].value;
+                if (exponent == floor(exponent) && fabs(exponent) <= largestIntegerPower)
+                {
+                    int n = static_cast<int>(exponent);
+                    if (n == 0)
+                    {
+                        return constant(1.0);
+                    }
+                    if (n == 1)
+                    {
+                        return left;
+                    }
+                    //x^-n is calculated as 1 / x^n
+                    int power = abs(n) > 1 ? addNode({ Node::IntegerPower, OpCode::Multiply, 0.0, abs(n), left, -1 }) : left;
+                    return n < 0 ? binary(OpCode::Divide, constant(1.0), power) : power;
+                }
+                if (exponent == 0.5)
+                {
+                    return unary(OpCode::Sqrt, left);
+                }
+            }
+            return addNode({ Node::Binary, op, 0.0, 0, left, right });
+        }
+
+        int parseExpression()
+        {
+            int left = parseTerm();
+            while (true)
+            {
+                if (accept('+'))
+                {
+                    left = binary(OpCode::Add, left, parseTerm());
+                }
+                else if (accept('-'))
+                {
+                    left = binary(OpCode::Subtract, left, parseTerm());
+                }
+                else
+                {
+                    return left;
+                }
+            }
+        }
+
+        int parseTerm()
+        {
+            int left = parseUnary();
+            while (true)
+            {
+                if (accept('*'))
+                {
+                    left = binary(OpCode::Multiply, left, parseUnary());
+                }
+                else if (accept('/'))
+                {
+                    left = binary(OpCode::Divide, left, parseUnary());
+                }
+                else
+                {
+                    return left;
+                }
+            }
+        }
+
+        int parseUnary()
+        {
+            if (accept('-'))
+            {
+                return unary(OpCode::Negate, parseUnary());
+            }
+            if (accept('+'))
+            {
+                return parseUnary();
+            }
+            return parsePower();
+        }
+
+        int parsePower()
+        {
+            int base = parsePrimary();
+            if (accept('^'))
+            {
+                //The exponent is parsed with parseUnary, so x^-2 works and x^y^z is x^(y^z)
+                return binary(OpCode::Power, base, parseUnary());
+            }
+            return base;
+        }
+
+        int parsePrimary()
+        {
+            skipSpaces();
+            if (position >= text.size())
+            {
+                fail("unexpected end of the expression");
+            }
+
+            if (accept('('))
+            {
+                int inside = parseExpression();
+                expect(')');
+                return inside;
+            }
+
+            char c = text[position];
+            if (isdigit(static_cast<unsigned char>(c)) || c == '.')
+            {
+                const char* start = text.c_str() + position;
+                char* end = nullptr;
+                double value = strtod(start, &end);
+                if (end == start)
+                {
+                    fail("invalid number");
+                }
+                position += end - start;
+                return constant(value);
+            }
+
+            if (isalpha(static_cast<unsigned char>(c)) || c == '_')
+            {
+                size_t start = position;
+                while (position < text.size() && (isalnum(static_cast<unsigned char>(text[position])) || text[position] == '_'))
+                {
+                    ++position;
+                }
+                string name = text.substr(start, position - start);
+
+                if (accept('('))
+                {
+                    return parseCall(name);
+                }
+                for (size_t i = 0; i < variables.size(); ++i)
+                {
+                    if (variables[i] == name)
+                    {
+                        return addNode({ Node::Variable, OpCode::Add, 0.0, static_cast<int>(i), -1, -1 });
+                    }
+                }
+                for (const auto& parameter : parameters)
+                {
+                    if (parameter.first == name)
+                    {
+                        return constant(parameter.second);
+                    }
+                }
+                if (name == "pi")
+                {
+                    return constant(3.14159265358979323846);
+                }
+                if (name == "e")
+                {
+                    return constant(2.71828182845904523536);
+                }
+                position = start;
+                fail("unknown name '" + name + "'");
+            }
+
+            fail("unexpected '" + string(1, c) + "'");
+        }
+
+        int parseCall(const string& name)
+        {
+            vector<int> arguments;
+            if (!accept(')'))
+            {
+                do
+                {
+                    arguments.push_back(parseExpression());
+                } while (accept(','));
+                expect(')');
+            }
+
+            struct Function
+            {
+                const char* name;
+                OpCode op;
+                size_t arguments;
+            };
+            static const Function functions[] = {
+                { "sin", OpCode::Sin, 1 }, { "cos", OpCode::Cos, 1 }, { "tan", OpCode::Tan, 1 },
+                { "exp", OpCode::Exp, 1 }, { "log", OpCode::Log, 1 }, { "sqrt", OpCode::Sqrt, 1 },
+                { "abs", OpCode::Abs, 1 }, { "pow", OpCode::Power, 2 }, { "min", OpCode::Min, 2 },
+                { "max", OpCode::Max, 2 }
+            };
+            for (const Function& function : functions)
+            {
+                if (name == function.name)
+                {
+                    if (arguments.size() != function.arguments)
+                    {
+                        fail(name + " takes " + to_string(function.arguments) + " argument(s)");
+                    }
+                    return function.arguments == 1 ? unary(function.op, arguments[0])
+                        : binary(function.op, arguments[0], arguments[1]);
+                }
+            }
+            fail("unknown function '" + name + "'");
+        }
+    };
+
+    //Turns the syntax tree into register instructions. Constants and temporaries get preliminary numbers while the
+    //code is made, because the number of constants is not known before the whole tree has been visited
+    class CodeGenerator
+    {
+    public:
+        CodeGenerator(const vector<Node>& nodes, int variableCount) : nodes(nodes), variableCount(variableCount)
+        {
+        }
+
+        vector<Instruction> code;
+        vector<double> constants;
+        int temporaryCount = 0;
+
+        int generate(int node)
+        {
+            const Node& n = nodes[node];
+            switch (n.kind)
+            {
+            case Node::Constant:
+                return constantRegister(n.value);
+            case Node::Variable:
+                return n.index;
+            case Node::Unary:
+            {
+                int operand = generate(n.left);
+                //The target is always a new register, so an instruction never writes to one of its own operands.
+                //The virtual machine relies on this when it marks the pointers as __restrict
+                int target = allocate();
+                release(operand);
+                code.push_back({ n.op, target, operand, -1 });
+                return target;
+            }
+            case Node::Binary:
+            {
+                int left = generate(n.left);
+                int right = generate(n.right);
+                int target = allocate();
+                release(left);
+                release(right);
+                code.push_back({ n.op, target, left, right });
+                return target;
+            }
+            case Node::IntegerPower:
+            {
+                //Square and multiply from the highest bit: x^5 = ((x*x)*(x*x))*x
+                int base = generate(n.left);
+                int highestBit = 0;
+                while ((n.index >> (highestBit + 1)) != 0)
+                {
+                    ++highestBit;
+                }
+                int current = base;
+                for (int bit = highestBit - 1; bit >= 0; --bit)
+                {
+                    current = multiply(current, current, base);
+                    if ((n.index >> bit) & 1)
+                    {
+                        current = multiply(current, base, base);
+                    }
+                }
+                release(base);
+                return current;
+            }
+            }
+            return -1;
+        }
+
+        //Gives the constants and the temporaries their final numbers after the variables
+        void finish(int& result)
+        {
+            int constantBase = variableCount;
+            int temporaryBase = variableCount + static_cast<int>(constants.size());
+            auto final = [&](int reg) {
+                if (reg >= temporaryTag)
+                {
+                    return temporaryBase + (reg - temporaryTag);
+                }
+                if (reg >= constantTag)
+                {
+                    return constantBase + (reg - constantTag);
+                }
+                return reg;
+            };
+            for (Instruction& instruction : code)
+            {
+                instruction.target = final(instruction.target);
+                instruction.left = final(instruction.left);
+                if (instruction.right >= 0)
+                {
+                    instruction.right = final(instruction.right);
+                }
+            }
+            result = final(result);
+        }
+
+    private:
+        const vector<Node>& nodes;
+        int variableCount;
+        vector<int> freeTemporaries;
+        static const int constantTag = 1 << 20;
+        static const int temporaryTag = 1 << 21;
+
+        bool isTemporary(int reg) const { return reg >= temporaryTag; }
+
+        int constantRegister(double value)
+        {
+            for (size_t i = 0; i < constants.size(); ++i)
+            {
+                if (memcmp(&constants[i], &value, sizeof(double)) == 0)
+                {
+                    return constantTag + static_cast<int>(i);
+                }
+            }
+            constants.push_back(value);
+            return constantTag + static_cast<int>(constants.size()) - 1;
+        }
+
+        int allocate()
+        {
+            if (!freeTemporaries.empty())
+            {
+                int reg = freeTemporaries.back();
+                freeTemporaries.pop_back();
+                return reg;
+            }
+            return temporaryTag + temporaryCount++;
+        }
+
+        void release(int reg)
+        {
+            if (isTemporary(reg))
+            {
+                freeTemporaries.push_back(reg);
+            }
+        }
+
+        //Emits target = left * right into a new register and releases left, unless it is the base of the power
+        int multiply(int left, int right, int base)
+        {
+            int target = allocate();
+            if (left != base)
+            {
+                release(left);
+            }
+            code.push_back({ OpCode::Multiply, target, left, right });
+            return target;
+        }
+    };
+
+    //The number of points the virtual machine handles for each instruction. Small enough for the registers to stay in the L1 cache
+    const size_t blockSize = 512;
+
+    struct AddOperation { double operator()(double a, double b) const { return a + b; } };
+    struct SubtractOperation { double operator()(double a, double b) const { return a - b; } };
+    struct MultiplyOperation { double operator()(double a, double b) const { return a * b; } };
+    struct DivideOperation { double operator()(double a, double b) const { return a / b; } };
+    struct MinOperation { double operator()(double a, double b) const { return a < b ? a : b; } };
+    struct MaxOperation { double operator()(double a, double b) const { return a > b ? a : b; } };
+
+    //Runs one operation with two operands over a block. When one operand is a constant it is read once
+    //into a local variable instead of from memory for every point. Each case is a simple loop the compiler can vectorize
+    template<typename Operation>
+    void runBinary(double* __restrict target, const double* __restrict a, const double* __restrict b,
+        bool aIsConstant, bool bIsConstant, size_t n)
+    {
+        Operation operation;
+        if (bIsConstant)
+        {
+            double constantB = b[0];
+            for (size_t i = 0; i < n; ++i) target[i] = operation(a[i], constantB);
+        }
+        else if (aIsConstant)
+        {
+            double constantA = a[0];
+            for (size_t i = 0; i < n; ++i) target[i] = operation(constantA, b[i]);
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i) target[i] = operation(a[i], b[i]);
+        }
+    }
+}
+
+Expression::Expression(const string& source, const vector<string>& variableNames, const vector<pair<string, double>>& parameters)
+    : text(source), variableCount(static_cast<int>(variableNames.size()))
+{
+    Parser parser(text, variableNames, parameters);
+    int root = parser.parse();
+
+    CodeGenerator generator(parser.nodes, variableCount);
+    result = generator.generate(root);
+    generator.finish(result);
+
+    code = generator.code;
+    constantValues = generator.constants;
+    registerCount = variableCount + static_cast<int>(constantValues.size()) + generator.temporaryCount;
+}
+
+void Expression::evaluate(const double* const* inputs, double* output, size_t count) const
+{
+    //The constant registers are filled once, the temporary registers are reused for every block
+    size_t constantCount = constantValues.size();
+    size_t temporaryCount = registerCount - variableCount - constantCount;
+    vector<double> storage((constantCount + temporaryCount) * blockSize);
+    for (size_t c = 0; c < constantCount; ++c)
+    {
+        fill(storage.begin() + c * blockSize, storage.begin() + (c + 1) * blockSize, constantValues[c]);
+    }
+
+    int firstTemporary = variableCount + static_cast<int>(constantCount);
+    auto isConstantRegister = [&](int reg) { return reg >= variableCount && reg < firstTemporary; };
+
+    vector<double*> registers(registerCount);
+    for (size_t r = variableCount; r < static_cast<size_t>(registerCount); ++r)
+    {
+        registers[r] = storage.data() + (r - variableCount) * blockSize;
+    }
+
+    for (size_t first = 0; first < count; first += blockSize)
+    {
+        size_t n = min(blockSize, count - first);
+
+        //The variable registers point straight into the input arrays, so nothing is copied
+        for (int v = 0; v < variableCount; ++v)
+        {
+            registers[v] = const_cast<double*>(inputs[v] + first);
+        }
+        //The last instruction writes straight into the output
+        if (!code.empty() && result >= firstTemporary)
+        {
+            registers[result] = output + first;
+        }
+
+        for (const Instruction& instruction : code)
+        {
+            double* __restrict target = registers[instruction.target];
+            const double* __restrict a = registers[instruction.left];
+            const double* __restrict b = instruction.right >= 0 ? registers[instruction.right] : a;
+            bool aIsConstant = isConstantRegister(instruction.left);
+            bool bIsConstant = instruction.right >= 0 && isConstantRegister(instruction.right);
+
+            switch (instruction.op)
+            {
+            case OpCode::Add:
+                runBinary<AddOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Subtract:
+                runBinary<SubtractOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Multiply:
+                runBinary<MultiplyOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Divide:
+                runBinary<DivideOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Min:
+                runBinary<MinOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Max:
+                runBinary<MaxOperation>(target, a, b, aIsConstant, bIsConstant, n);
+                break;
+            case OpCode::Negate:
+                for (size_t i = 0; i < n; ++i) target[i] = -a[i];
+                break;
+            case OpCode::Abs:
+                for (size_t i = 0; i < n; ++i) target[i] = fabs(a[i]);
+                break;
+            case OpCode::Sqrt:
+                for (size_t i = 0; i < n; ++i) target[i] = sqrt(a[i]);
+                break;
+            default:
+                for (size_t i = 0; i < n; ++i) target[i] = apply(instruction.op, a[i], b[i]);
+                break;
+            }
+        }
+
+        //When the whole expression is a variable or a constant there are no instructions to write the output
+        if (code.empty() || result < firstTemporary)
+        {
+            copy(registers[result], registers[result] + n, output + first);
+        }
+    }
+}
+
+double Expression::evaluate(const double* values) const
+{
+    vector<const double*> inputs(variableCount);
+    for (int v = 0; v < variableCount; ++v)
+    {
+        inputs[v] = values + v;
+    }
+    double output = 0.0;
+    evaluate(inputs.data(), &output, 1);
+    return output;
+}
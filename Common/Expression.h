@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+//The operations in the bytecode. Every instruction reads one or two registers and writes one register
+enum class OpCode : unsigned char
+{
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Negate,
+    Abs,
+    Sqrt,
+    Min,
+    Max,
+    Power,
+    Sin,
+    Cos,
+    Tan,
+    Exp,
+    Log
+};
+
+//One bytecode instruction: target = left op right. 'right' is -1 for the operations with only one operand
+struct Instruction
+{
+    OpCode op;
+    int target;
+    int left;
+    int right;
+};
+
+//A function that is given as text at runtime, for example "2*x^2*y" or "a*t*cos(t)".
+//The text is parsed once, constant parts are calculated right away (constant folding) and integer powers
+//are turned into multiplications. The result is a list of register instructions that a small virtual machine
+//runs over whole blocks of points, so the cost of reading each instruction is shared by many points.
+//
+//The registers are numbered in this order: first one register for each variable, then one for each constant,
+//and at the end the temporary registers that hold the intermediate results
+class Expression
+{
+public:
+    //Compiles 'source'. 'variableNames' are the inputs that change from point to point (x, y, t).
+    //'parameters' are names with a fixed value (the spiral a and b) that are folded into the bytecode as constants.
+    //Throws runtime_error with the position of the error when the text is not a valid expression
+    Expression(const std::string& source, const std::vector<std::string>& variableNames,
+        const std::vector<std::pair<std::string, double>>& parameters = {});
+
+    //Evaluates the expression for 'count' points. inputs[v] points to the 'count' values of variable number v
+    void evaluate(const double* const* inputs, double* output, size_t count) const;
+
+    //Evaluates the expression for a single point. values[v] is the value of variable number v
+    double evaluate(const double* values) const;
+
+    const std::string& source() const { return text; }
+    const std::vector<Instruction>& instructions() const { return code; }
+    const std::vector<double>& constants() const { return constantValues; }
+    int numberOfVariables() const { return variableCount; }
+    int numberOfRegisters() const { return registerCount; }
+    int resultRegister() const { return result; }
+
+private:
+    std::string text;
+    std::vector<Instruction> code;
+    std::vector<double> constantValues;
+    int variableCount;
+    int registerCount;
+    int result;
+};
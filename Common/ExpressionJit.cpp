@@ -0,0 +1,580 @@
+#include "ExpressionJit.h"
+#include <vector>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define EXPRESSION_JIT_X64 1
+#endif
+
+#ifdef EXPRESSION_JIT_X64
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <sys/mman.h>
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef EXPRESSION_JIT_X64
+namespace
+{
+    //General purpose registers
+    const int RAX = 0, RCX = 1, RDX = 2, RSP = 4, RSI = 6, RDI = 7, R8 = 8;
+
+    //SSE prefixes and the matching VEX "pp" field. 0x66 means packed doubles, 0xF2 a scalar double
+    const unsigned char packed = 0x66, scalar = 0xF2;
+
+    //SSE/AVX opcodes (all in the 0F map)
+    const unsigned char MOVUPD_LOAD = 0x10, MOVUPD_STORE = 0x11, MOVAPD = 0x28, SQRT = 0x51, ANDN = 0x55, XOR = 0x57,
+        ADD = 0x58, MUL = 0x59, SUB = 0x5C, MIN = 0x5D, DIV = 0x5E, MAX = 0x5F;
+
+    //xmm14 holds -0.0 in every lane (used for negation and abs), xmm15 is a scratch register
+    const int signMaskRegister = 14, scratchRegister = 15;
+    const int largestRegisterCount = 14;
+    const int largestVariableCount = 4;
+
+    //Asks the processor (cpuid) and the operating system (xgetbv) if the AVX registers can be used
+    bool hasAvx()
+    {
+        unsigned int info[4] = { 0, 0, 0, 0 };
+#ifdef _WIN32
+        __cpuid(reinterpret_cast<int*>(info), 1);
+#else
+        __get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+#endif
+        bool osxsave = (info[2] & (1u << 27)) != 0;
+        bool avx = (info[2] & (1u << 28)) != 0;
+        if (!osxsave || !avx)
+        {
+            return false;
+        }
+#ifdef _WIN32
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        return (xcr0 & 0x6) == 0x6;
+    }
+
+    bool canTranslate(const Expression& expression)
+    {
+        if (expression.numberOfVariables() > largestVariableCount || expression.numberOfRegisters() > largestRegisterCount)
+        {
+            return false;
+        }
+        for (const Instruction& instruction : expression.instructions())
+        {
+            switch (instruction.op)
+            {
+            case OpCode::Add: case OpCode::Subtract: case OpCode::Multiply: case OpCode::Divide:
+            case OpCode::Negate: case OpCode::Abs: case OpCode::Sqrt: case OpCode::Min: case OpCode::Max:
+                break;
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //Writes the bytes of the x86-64 instructions. Only the few instruction forms the translator needs are here
+    class Assembler
+    {
+    public:
+        vector<unsigned char> bytes;
+
+        void byte(unsigned int value) { bytes.push_back(static_cast<unsigned char>(value)); }
+        void bytes2(unsigned int a, unsigned int b) { byte(a); byte(b); }
+        void bytes3(unsigned int a, unsigned int b, unsigned int c) { byte(a); byte(b); byte(c); }
+
+        void int32(int32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                byte((static_cast<uint32_t>(value) >> (8 * i)) & 0xFF);
+            }
+        }
+
+        void int64(uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                byte((value >> (8 * i)) & 0xFF);
+            }
+        }
+
+        size_t position() const { return bytes.size(); }
+
+        //Emits a 32-bit jump distance that is filled in by patchJump when the target is known
+        size_t jumpPlaceholder()
+        {
+            size_t at = position();
+            int32(0);
+            return at;
+        }
+
+        void patchJump(size_t at, size_t target)
+        {
+            int32_t distance = static_cast<int32_t>(target) - static_cast<int32_t>(at + 4);
+            memcpy(&bytes[at], &distance, 4);
+        }
+
+        //Legacy SSE form with a register operand: [prefix] [REX] 0F op modrm
+        void sse(unsigned char prefix, unsigned char op, int reg, int rm)
+        {
+            byte(prefix);
+            rex(reg, rm);
+            bytes3(0x0F, op, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        //Legacy SSE form with the memory operand [base + rax*8]
+        void sseIndexed(unsigned char prefix, unsigned char op, int reg, int base)
+        {
+            byte(prefix);
+            rex(reg, base);
+            bytes3(0x0F, op, 0x04 | ((reg & 7) << 3));
+            byte(0xC0 | (RAX << 3) | (base & 7));
+        }
+
+        //Legacy SSE form with the memory operand [rax]
+        void sseAtRax(unsigned char prefix, unsigned char op, int reg)
+        {
+            byte(prefix);
+            rex(reg, RAX);
+            bytes3(0x0F, op, ((reg & 7) << 3) | RAX);
+        }
+
+        //Legacy SSE form with the memory operand [rsp + displacement]
+        void sseStack(unsigned char prefix, unsigned char op, int reg, int32_t displacement)
+        {
+            byte(prefix);
+            rex(reg, RSP);
+            bytes3(0x0F, op, 0x80 | ((reg & 7) << 3) | 4);
+            byte(0x24);
+            int32(displacement);
+        }
+
+        //Three byte VEX form with a register operand: reg = vvvv op rm. L selects 256-bit (1) or 128-bit (0) registers
+        void vex(unsigned char prefix, int L, unsigned char op, int reg, int vvvv, int rm)
+        {
+            vexPrefix(prefix, L, reg, vvvv, rm);
+            bytes2(op, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+        }
+
+        //Three byte VEX form with the memory operand [base + rax*8]
+        void vexIndexed(unsigned char prefix, int L, unsigned char op, int reg, int base)
+        {
+            vexPrefix(prefix, L, reg, 0, base);
+            bytes2(op, 0x04 | ((reg & 7) << 3));
+            byte(0xC0 | (RAX << 3) | (base & 7));
+        }
+
+        //Three byte VEX form with the memory operand [rax]
+        void vexAtRax(unsigned char prefix, int L, unsigned char op, int reg)
+        {
+            vexPrefix(prefix, L, reg, 0, RAX);
+            bytes2(op, ((reg & 7) << 3) | RAX);
+        }
+
+        //mov rax, imm64. Returns the position of the 64-bit value, so it can be filled in later
+        size_t movRaxImmediate()
+        {
+            bytes2(0x48, 0xB8);
+            size_t at = position();
+            int64(0);
+            return at;
+        }
+
+    private:
+        //REX prefix with the R and B bits for registers 8-15. Left out when it is not needed
+        void rex(int reg, int rm)
+        {
+            unsigned int value = 0x40 | ((reg >= 8) << 2) | (rm >= 8);
+            if (value != 0x40)
+            {
+                byte(value);
+            }
+        }
+
+        void vexPrefix(unsigned char prefix, int L, int reg, int vvvv, int rm)
+        {
+            unsigned int pp = prefix == packed ? 1 : 3;
+            byte(0xC4);
+            //Inverted R, X and B bits, then map 0F
+            byte((reg >= 8 ? 0 : 0x80) | 0x40 | (rm >= 8 ? 0 : 0x20) | 0x01);
+            //W = 0, inverted vvvv, L and pp
+            byte(((~vvvv & 0xF) << 3) | (L << 2) | pp);
+        }
+    };
+
+    //Translates the bytecode into one function with the signature of ExpressionJit::Kernel
+    class Translator
+    {
+    public:
+        Translator(const Expression& expression, bool avx) : expression(expression), avx(avx)
+        {
+        }
+
+        Assembler code;
+        //Positions of the 64-bit addresses that must point to the constant pool, and which pool entry they use
+        vector<pair<size_t, size_t>> poolReferences;
+
+        void translate()
+        {
+            prologue();
+
+            //The pointers to the input arrays are kept in r8-r11
+            for (int v = 0; v < expression.numberOfVariables(); ++v)
+            {
+                code.bytes3(0x4C, 0x8B, 0x40 | (v << 3) | RDI);
+                code.byte(8 * v);
+            }
+
+            //The constants and the sign mask are loaded into their registers once, before the loop
+            int firstConstant = expression.numberOfVariables();
+            for (size_t c = 0; c < expression.constants().size(); ++c)
+            {
+                loadFromPool(static_cast<int>(firstConstant + c), c);
+            }
+            loadFromPool(signMaskRegister, expression.constants().size());
+
+            //xor eax, eax (the index i); mov rcx, rdx; and rcx, -lanes (the number of points the wide loop handles)
+            int lanes = avx ? 4 : 2;
+            code.bytes2(0x31, 0xC0);
+            code.bytes3(0x48, 0x89, 0xD1);
+            code.bytes3(0x48, 0x83, 0xE1);
+            code.byte(256 - lanes);
+
+            //The wide loop
+            size_t wideLoop = code.position();
+            code.bytes3(0x48, 0x39, 0xC8); //cmp rax, rcx
+            code.bytes2(0x0F, 0x83); //jae
+            size_t toTail = code.jumpPlaceholder();
+            body(true);
+            code.bytes3(0x48, 0x83, 0xC0); //add rax, lanes
+            code.byte(lanes);
+            code.byte(0xE9); //jmp
+            code.patchJump(code.jumpPlaceholder(), wideLoop);
+
+            //The last points one at a time
+            size_t tailLoop = code.position();
+            code.patchJump(toTail, tailLoop);
+            code.bytes3(0x48, 0x39, 0xD0); //cmp rax, rdx
+            code.bytes2(0x0F, 0x83); //jae
+            size_t toEnd = code.jumpPlaceholder();
+            body(false);
+            code.bytes3(0x48, 0x83, 0xC0); //add rax, 1
+            code.byte(1);
+            code.byte(0xE9); //jmp
+            code.patchJump(code.jumpPlaceholder(), tailLoop);
+
+            code.patchJump(toEnd, code.position());
+            if (avx)
+            {
+                code.bytes3(0xC5, 0xF8, 0x77); //vzeroupper
+            }
+            epilogue();
+        }
+
+    private:
+        const Expression& expression;
+        bool avx;
+
+#ifdef _WIN32
+        //Windows passes the arguments in rcx, rdx, r8 and wants rsi, rdi and xmm6-xmm15 kept. The arguments are moved to
+        //rdi, rsi, rdx like on Linux, so the rest of the code is the same
+        void prologue()
+        {
+            code.byte(0x56); //push rsi
+            code.byte(0x57); //push rdi
+            code.bytes3(0x48, 0x81, 0xEC); //sub rsp, 168
+            code.int32(168);
+            for (int x = 6; x <= 15; ++x)
+            {
+                code.sseStack(packed, MOVUPD_STORE, x, 16 * (x - 6));
+            }
+            code.bytes3(0x48, 0x89, 0xCF); //mov rdi, rcx
+            code.bytes3(0x48, 0x89, 0xD6); //mov rsi, rdx
+            code.bytes3(0x4C, 0x89, 0xC2); //mov rdx, r8
+        }
+
+        void epilogue()
+        {
+            for (int x = 6; x <= 15; ++x)
+            {
+                code.sseStack(packed, MOVUPD_LOAD, x, 16 * (x - 6));
+            }
+            code.bytes3(0x48, 0x81, 0xC4); //add rsp, 168
+            code.int32(168);
+            code.byte(0x5F); //pop rdi
+            code.byte(0x5E); //pop rsi
+            code.byte(0xC3); //ret
+        }
+#else
+        //Linux passes the arguments in rdi, rsi, rdx and all xmm registers may be changed
+        void prologue()
+        {
+        }
+
+        void epilogue()
+        {
+            code.byte(0xC3); //ret
+        }
+#endif
+
+        void loadFromPool(int reg, size_t entry)
+        {
+            poolReferences.push_back({ code.movRaxImmediate(), entry });
+            if (avx)
+            {
+                code.vexAtRax(packed, 1, MOVUPD_LOAD, reg);
+            }
+            else
+            {
+                code.sseAtRax(packed, MOVUPD_LOAD, reg);
+            }
+        }
+
+        //Loads the variables for point i, runs the instructions and stores the result. 'wide' selects full registers,
+        //otherwise only the lowest double is used
+        void body(bool wide)
+        {
+            unsigned char width = wide ? packed : scalar;
+            int L = wide ? 1 : 0;
+
+            for (int v = 0; v < expression.numberOfVariables(); ++v)
+            {
+                if (avx)
+                {
+                    code.vexIndexed(width, L, MOVUPD_LOAD, v, R8 + v);
+                }
+                else
+                {
+                    code.sseIndexed(width, MOVUPD_LOAD, v, R8 + v);
+                }
+            }
+
+            for (const Instruction& instruction : expression.instructions())
+            {
+                if (avx)
+                {
+                    emitAvx(instruction, width, L);
+                }
+                else
+                {
+                    emitSse(instruction, width);
+                }
+            }
+
+            if (avx)
+            {
+                code.vexIndexed(width, L, MOVUPD_STORE, expression.resultRegister(), RSI);
+            }
+            else
+            {
+                code.sseIndexed(width, MOVUPD_STORE, expression.resultRegister(), RSI);
+            }
+        }
+
+        static unsigned char opcode(OpCode op)
+        {
+            switch (op)
+            {
+            case OpCode::Add: return ADD;
+            case OpCode::Subtract: return SUB;
+            case OpCode::Multiply: return MUL;
+            case OpCode::Divide: return DIV;
+            case OpCode::Min: return MIN;
+            case OpCode::Max: return MAX;
+            default: return SQRT;
+            }
+        }
+
+        //AVX has three operands, so every instruction maps to one machine instruction
+        void emitAvx(const Instruction& instruction, unsigned char width, int L)
+        {
+            int t = instruction.target, a = instruction.left, b = instruction.right;
+            switch (instruction.op)
+            {
+            case OpCode::Negate:
+                code.vex(packed, L, XOR, t, a, signMaskRegister);
+                break;
+            case OpCode::Abs:
+                code.vex(packed, L, ANDN, t, signMaskRegister, a);
+                break;
+            case OpCode::Sqrt:
+                code.vex(width, L, SQRT, t, width == packed ? 0 : a, a);
+                break;
+            default:
+                code.vex(width, L, opcode(instruction.op), t, a, b);
+                break;
+            }
+        }
+
+        //SSE has two operands (the first is also the target), so the left operand is copied to the target first
+        void emitSse(const Instruction& instruction, unsigned char width)
+        {
+            int t = instruction.target, a = instruction.left, b = instruction.right;
+            switch (instruction.op)
+            {
+            case OpCode::Negate:
+                move(t, a);
+                code.sse(packed, XOR, t, signMaskRegister);
+                break;
+            case OpCode::Abs:
+                move(scratchRegister, signMaskRegister);
+                code.sse(packed, ANDN, scratchRegister, a);
+                move(t, scratchRegister);
+                break;
+            case OpCode::Sqrt:
+                code.sse(width, SQRT, t, a);
+                break;
+            default:
+                if (t == b && t != a)
+                {
+                    move(scratchRegister, a);
+                    code.sse(width, opcode(instruction.op), scratchRegister, b);
+                    move(t, scratchRegister);
+                }
+                else
+                {
+                    move(t, a);
+                    code.sse(width, opcode(instruction.op), t, b);
+                }
+                break;
+            }
+        }
+
+        void move(int target, int source)
+        {
+            if (target != source)
+            {
+                code.sse(packed, MOVAPD, target, source);
+            }
+        }
+    };
+
+    const size_t poolEntrySize = 4 * sizeof(double);
+
+    //Reserves a page that can be written to. The code is copied in and makeExecutable is called afterwards
+    void* allocateWritable(size_t size)
+    {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory == MAP_FAILED ? nullptr : memory;
+#endif
+    }
+
+    //Makes the page read-only and executable, so it is never writable and executable at the same time
+    bool makeExecutable(void* memory, size_t size)
+    {
+#ifdef _WIN32
+        DWORD oldProtection;
+        if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &oldProtection))
+        {
+            return false;
+        }
+        FlushInstructionCache(GetCurrentProcess(), memory, size);
+        return true;
+#else
+        return mprotect(memory, size, PROT_READ | PROT_EXEC) == 0;
+#endif
+    }
+
+    void freeExecutable(void* memory, size_t size)
+    {
+#ifdef _WIN32
+        (void)size;
+        VirtualFree(memory, 0, MEM_RELEASE);
+#else
+        munmap(memory, size);
+#endif
+    }
+}
+#endif
+
+ExpressionJit::ExpressionJit(const Expression& expression)
+    : bytecode(expression), memory(nullptr), memorySize(0), kernel(nullptr), usesAvx(false)
+{
+#ifdef EXPRESSION_JIT_X64
+    if (!canTranslate(bytecode))
+    {
+        return;
+    }
+
+    usesAvx = hasAvx();
+    Translator translator(bytecode, usesAvx);
+    translator.translate();
+
+    //The constant pool comes after the code, with every constant repeated 4 times so a whole register can be loaded
+    vector<unsigned char> image = translator.code.bytes;
+    image.resize((image.size() + poolEntrySize - 1) / poolEntrySize * poolEntrySize);
+    size_t poolOffset = image.size();
+    vector<double> pool;
+    for (double constant : bytecode.constants())
+    {
+        pool.insert(pool.end(), 4, constant);
+    }
+    pool.insert(pool.end(), 4, -0.0);
+    image.resize(poolOffset + pool.size() * sizeof(double));
+    memcpy(&image[poolOffset], pool.data(), pool.size() * sizeof(double));
+
+    //The addresses of the constants are only known when the page is reserved, so they are filled in after that
+    void* page = allocateWritable(image.size());
+    if (page == nullptr)
+    {
+        return;
+    }
+    for (const auto& reference : translator.poolReferences)
+    {
+        uint64_t address = reinterpret_cast<uint64_t>(page) + poolOffset + reference.second * poolEntrySize;
+        memcpy(&image[reference.first], &address, sizeof(address));
+    }
+    memcpy(page, image.data(), image.size());
+    if (!makeExecutable(page, image.size()))
+    {
+        freeExecutable(page, image.size());
+        return;
+    }
+    memory = page;
+    memorySize = image.size();
+    kernel = reinterpret_cast<Kernel>(memory);
+#endif
+}
+
+ExpressionJit::~ExpressionJit()
+{
+#ifdef EXPRESSION_JIT_X64
+    if (memory != nullptr)
+    {
+        freeExecutable(memory, memorySize);
+    }
+#endif
+}
+
+void ExpressionJit::evaluate(const double* const* inputs, double* output, size_t count) const
+{
+    if (kernel != nullptr)
+    {
+        kernel(inputs, output, count);
+    }
+    else
+    {
+        bytecode.evaluate(inputs, output, count);
+    }
+}
+
+const char* ExpressionJit::backendName() const
+{
+    if (kernel == nullptr)
+    {
+        return "interpreter";
+    }
+    return usesAvx ? "AVX" : "SSE2";
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Expression.h"
+#include <cstddef>
+
+//Translates the bytecode of an Expression into x86-64 machine code when the program runs, so the inner loop runs at
+//native speed without a C++ compiler. The code is written into a page that is made executable with mmap (Linux)
+//or VirtualAlloc (Windows). Each bytecode register becomes one SSE/AVX register. The loop handles 4 points for each
+//instruction with AVX, or 2 with SSE2, and does the last points one at a time.
+//
+//Only +, -, *, /, negation, abs, sqrt, min and max can be translated, with at most 4 variables and 14 registers.
+//For other expressions, or when the processor is not x86-64, evaluate() uses the bytecode interpreter instead
+class ExpressionJit
+{
+public:
+    explicit ExpressionJit(const Expression& expression);
+    ~ExpressionJit();
+
+    ExpressionJit(const ExpressionJit&) = delete;
+    ExpressionJit& operator=(const ExpressionJit&) = delete;
+
+    //Evaluates the expression for 'count' points in the same way as Expression::evaluate
+    void evaluate(const double* const* inputs, double* output, size_t count) const;
+
+    //True when the machine code is used, false when the interpreter is used
+    bool isNative() const { return kernel != nullptr; }
+
+    //"AVX", "SSE2" or "interpreter"
+    const char* backendName() const;
+
+    const Expression& expression() const { return bytecode; }
+
+private:
+    typedef void (*Kernel)(const double* const* inputs, double* output, size_t count);
+
+    Expression bytecode;
+    void* memory;
+    size_t memorySize;
+    Kernel kernel;
+    bool usesAvx;
+};
@@ -0,0 +1,118 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw runtime_error("Could not open " + path);
+    }
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        throw runtime_error("Could not read the size of " + path);
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    //An empty file can not be mapped, but there is nothing to read either
+    if (length == 0)
+    {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        throw runtime_error("Could not map " + path);
+    }
+    mappingHandle = mapping;
+
+    bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (bytes == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw runtime_error("Could not map " + path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (bytes != nullptr)
+    {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle != nullptr)
+    {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr)
+    {
+        CloseHandle(fileHandle);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const string& path)
+{
+    fileDescriptor = open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0)
+    {
+        throw runtime_error("Could not open " + path);
+    }
+
+    struct stat status;
+    if (fstat(fileDescriptor, &status) != 0)
+    {
+        close(fileDescriptor);
+        throw runtime_error("Could not read the size of " + path);
+    }
+    length = static_cast<size_t>(status.st_size);
+    //An empty file can not be mapped, but there is nothing to read either
+    if (length == 0)
+    {
+        return;
+    }
+
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    if (mapped == MAP_FAILED)
+    {
+        close(fileDescriptor);
+        throw runtime_error("Could not map " + path);
+    }
+    //The file is read from the start to the end, so the kernel can read ahead
+    madvise(mapped, length, MADV_SEQUENTIAL);
+    bytes = static_cast<const char*>(mapped);
+}
+
+MappedFile::~MappedFile()
+{
+    if (bytes != nullptr)
+    {
+        munmap(const_cast<char*>(bytes), length);
+    }
+    if (fileDescriptor >= 0)
+    {
+        close(fileDescriptor);
+    }
+}
+
+#endif
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+//Maps a whole file into memory for reading. The operating system reads the pages of the file the first time they are
+//used, so opening even a very large file is instant and no copy of it is made in the program.
+//The constructor throws runtime_error when the file can not be opened or mapped
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
@@ -0,0 +1,283 @@
+#include "MeshExport.h"
+#include "BulkWriter.h"
+#include "TextWriter.h"
+#include "PackedVertex.h"
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+using namespace std;
+
+namespace
+{
+    //The number of vertices that are packed before they are written
+    const size_t vertexBlock = 1 << 16;
+
+    bool isObj(const string& path)
+    {
+        return path.size() >= 4 && path.compare(path.size() - 4, 4, ".obj") == 0;
+    }
+
+    bool hasColors(const MeshVertices& vertices)
+    {
+        return vertices.red != nullptr && vertices.green != nullptr && vertices.blue != nullptr;
+    }
+
+    //The indices are stored as int in PLY and OBJ
+    void checkCount(size_t count)
+    {
+        if (count > static_cast<size_t>(INT_MAX))
+        {
+            throw runtime_error("A mesh can not have more than " + to_string(INT_MAX) + " vertices");
+        }
+    }
+
+    template<typename T>
+    void put(vector<char>& bytes, T value)
+    {
+        size_t size = bytes.size();
+        bytes.resize(size + sizeof(T));
+        memcpy(bytes.data() + size, &value, sizeof(T));
+    }
+
+    //The PLY header up to the elements of the faces or lines
+    string plyHeader(const MeshVertices& vertices)
+    {
+        string header = "ply\nformat binary_little_endian 1.0\nelement vertex " + to_string(vertices.count) +
+            "\nproperty float x\nproperty float y\nproperty float z\n";
+        if (hasColors(vertices))
+        {
+            header += "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+        }
+        return header;
+    }
+
+    size_t plyVertexSize(const MeshVertices& vertices)
+    {
+        return 3 * sizeof(float) + (hasColors(vertices) ? 3 : 0);
+    }
+
+    void writePlyVertices(BulkWriter& file, const MeshVertices& vertices)
+    {
+        bool colors = hasColors(vertices);
+        vector<char> bytes;
+        bytes.reserve(vertexBlock * plyVertexSize(vertices));
+        for (size_t first = 0; first < vertices.count; first += vertexBlock)
+        {
+            bytes.clear();
+            size_t last = min(first + vertexBlock, vertices.count);
+            for (size_t i = first; i < last; ++i)
+            {
+                size_t k = i * vertices.stride;
+                put(bytes, vertices.x[k]);
+                put(bytes, vertices.y[k]);
+                put(bytes, vertices.z[k]);
+                if (colors)
+                {
+                    put(bytes, colorByte(vertices.red[k]));
+                    put(bytes, colorByte(vertices.green[k]));
+                    put(bytes, colorByte(vertices.blue[k]));
+                }
+            }
+            file.write(bytes.data(), bytes.size());
+        }
+    }
+
+    void writeObjVertices(TextWriter& file, const MeshVertices& vertices)
+    {
+        bool colors = hasColors(vertices);
+        for (size_t i = 0; i < vertices.count; ++i)
+        {
+            size_t k = i * vertices.stride;
+            file << "v " << vertices.x[k] << ' ' << vertices.y[k] << ' ' << vertices.z[k];
+            if (colors)
+            {
+                file << ' ' << vertices.red[k] << ' ' << vertices.green[k] << ' ' << vertices.blue[k];
+            }
+            file << '\n';
+        }
+    }
+
+    //OBJ text is only opened like ofstream, so a file that could not be opened is found here
+    void checkOpen(const TextWriter& file, const string& path)
+    {
+        if (!file.isOpen())
+        {
+            throw runtime_error("Could not open " + path + " for writing");
+        }
+    }
+}
+
+void writeGridMesh(const string& path, const MeshVertices& vertices, int countX, int countY)
+{
+    if (countX < 0 || countY < 0 || static_cast<size_t>(countX) * countY != vertices.count)
+    {
+        throw runtime_error("A grid of " + to_string(countX) + " x " + to_string(countY) + " points can not have " +
+            to_string(vertices.count) + " vertices");
+    }
+    checkCount(vertices.count);
+    size_t cellCount = countX > 1 && countY > 1 ? static_cast<size_t>(countX - 1) * (countY - 1) : 0;
+
+    //The two triangles of cell (i, j), counter-clockwise seen from above when x grows with i and y with j
+    auto cellTriangles = [countY](int i, int j, int* triangles)
+    {
+        int corner = i * countY + j;
+        int next = corner + countY;
+        triangles[0] = corner;
+        triangles[1] = next;
+        triangles[2] = next + 1;
+        triangles[3] = corner;
+        triangles[4] = next + 1;
+        triangles[5] = corner + 1;
+    };
+
+    if (isObj(path))
+    {
+        TextWriter file(path);
+        checkOpen(file, path);
+        file << "# " << countX << " x " << countY << " grid\n";
+        writeObjVertices(file, vertices);
+        //OBJ counts the vertices from 1
+        for (int i = 0; i + 1 < countX; ++i)
+        {
+            for (int j = 0; j + 1 < countY; ++j)
+            {
+                int triangles[6];
+                cellTriangles(i, j, triangles);
+                file << "f " << triangles[0] + 1 << ' ' << triangles[1] + 1 << ' ' << triangles[2] + 1 << '\n';
+                file << "f " << triangles[3] + 1 << ' ' << triangles[4] + 1 << ' ' << triangles[5] + 1 << '\n';
+            }
+        }
+        file.close();
+        return;
+    }
+
+    string header = plyHeader(vertices) + "element face " + to_string(2 * cellCount) +
+        "\nproperty list uchar int vertex_indices\nend_header\n";
+    //Every face is the count 3 and three indices
+    const size_t faceSize = 1 + 3 * sizeof(int32_t);
+    BulkWriter file(path, header.size() + vertices.count * plyVertexSize(vertices) + 2 * cellCount * faceSize);
+    file.write(header.data(), header.size());
+    writePlyVertices(file, vertices);
+
+    vector<char> row;
+    row.reserve(2 * max(countY - 1, 0) * faceSize);
+    for (int i = 0; i + 1 < countX; ++i)
+    {
+        row.clear();
+        for (int j = 0; j + 1 < countY; ++j)
+        {
+            int triangles[6];
+            cellTriangles(i, j, triangles);
+            for (int t = 0; t < 2; ++t)
+            {
+                put(row, static_cast<uint8_t>(3));
+                put(row, static_cast<int32_t>(triangles[3 * t]));
+                put(row, static_cast<int32_t>(triangles[3 * t + 1]));
+                put(row, static_cast<int32_t>(triangles[3 * t + 2]));
+            }
+        }
+        file.write(row.data(), row.size());
+    }
+    file.close();
+}
+
+void writePolylineMesh(const string& path, const MeshVertices& vertices)
+{
+    checkCount(vertices.count);
+    size_t edgeCount = vertices.count > 1 ? vertices.count - 1 : 0;
+
+    if (isObj(path))
+    {
+        TextWriter file(path);
+        checkOpen(file, path);
+        writeObjVertices(file, vertices);
+        if (edgeCount > 0)
+        {
+            file << 'l';
+            for (size_t i = 0; i < vertices.count; ++i)
+            {
+                file << ' ' << i + 1;
+            }
+            file << '\n';
+        }
+        file.close();
+        return;
+    }
+
+    string header = plyHeader(vertices) + "element edge " + to_string(edgeCount) +
+        "\nproperty int vertex1\nproperty int vertex2\nend_header\n";
+    const size_t edgeSize = 2 * sizeof(int32_t);
+    BulkWriter file(path, header.size() + vertices.count * plyVertexSize(vertices) + edgeCount * edgeSize);
+    file.write(header.data(), header.size());
+    writePlyVertices(file, vertices);
+
+    vector<char> edges;
+    edges.reserve(vertexBlock * edgeSize);
+    for (size_t first = 0; first < edgeCount; first += vertexBlock)
+    {
+        edges.clear();
+        for (size_t i = first; i < min(first + vertexBlock, edgeCount); ++i)
+        {
+            put(edges, static_cast<int32_t>(i));
+            put(edges, static_cast<int32_t>(i + 1));
+        }
+        file.write(edges.data(), edges.size());
+    }
+    file.close();
+}
+
+void benchmarkMeshExport(int gridSize)
+{
+    //The Oppgave3 surface, as the columns it has in Data.bin
+    size_t count = static_cast<size_t>(gridSize) * gridSize;
+    vector<float> columns[6];
+    for (vector<float>& column : columns)
+    {
+        column.resize(count);
+    }
+    for (int i = 0; i < gridSize; ++i)
+    {
+        double x = -2.0 + 4.0 * i / (gridSize - 1);
+        for (int j = 0; j < gridSize; ++j)
+        {
+            double y = -2.0 + 4.0 * j / (gridSize - 1);
+            size_t k = static_cast<size_t>(i) * gridSize + j;
+            columns[0][k] = static_cast<float>(x);
+            columns[1][k] = static_cast<float>(y);
+            columns[2][k] = static_cast<float>(2.0 * x * x * y);
+            columns[3][k] = columns[4][k] = columns[5][k] = static_cast<float>((x + 2.0) / 4.0);
+        }
+    }
+    MeshVertices vertices;
+    vertices.x = columns[0].data();
+    vertices.y = columns[1].data();
+    vertices.z = columns[2].data();
+    vertices.red = columns[3].data();
+    vertices.green = columns[4].data();
+    vertices.blue = columns[5].data();
+    vertices.count = count;
+
+    for (const char* path : { "MeshBenchmark.ply", "MeshBenchmark.obj" })
+    {
+        try
+        {
+            auto begin = chrono::steady_clock::now();
+            writeGridMesh(path, vertices, gridSize, gridSize);
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+            cout << "Saved a " << gridSize << " x " << gridSize << " grid as " << path << " in " << seconds
+                << " seconds" << endl;
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to save " << path << ": " << error.what() << endl;
+        }
+        remove(path);
+    }
+}
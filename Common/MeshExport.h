@@ -0,0 +1,36 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+//Where the vertices of a mesh are in memory. Value i of a coordinate is read from x[i * stride], so both the columns of
+//Data.bin (stride 1) and the x, y, z arrays of the vertex buffers (stride 3) are written without a copy.
+//The colors are optional and have the same stride. They are between 0 and 1
+struct MeshVertices
+{
+    const float* x = nullptr;
+    const float* y = nullptr;
+    const float* z = nullptr;
+    const float* red = nullptr;
+    const float* green = nullptr;
+    const float* blue = nullptr;
+    size_t stride = 1;
+    size_t count = 0;
+};
+
+//Saves a mesh with shared vertices, so each point is stored once and the faces or lines refer to it by its index.
+//A path that ends with .obj is written as Wavefront OBJ text (the colors are added after x, y, z on the v lines, which
+//MeshLab and Blender read). Any other path is written as binary little-endian PLY with the colors as bytes, which is
+//much smaller and faster to read.
+//The vertices are written straight from their arrays, and the faces are made one row at a time, so nothing as large
+//as the mesh is allocated.
+//
+//Both throw runtime_error when the file can not be written
+
+//A grid of countX rows of countY points, with point (i, j) at index i * countY + j, as two triangles for each cell
+void writeGridMesh(const std::string& path, const MeshVertices& vertices, int countX, int countY);
+
+//A curve through all the points in order, as PLY edges or an OBJ line
+void writePolylineMesh(const std::string& path, const MeshVertices& vertices);
+
+//Saves a gridSize * gridSize surface as PLY and as OBJ and prints how long each took. The files are deleted afterwards
+void benchmarkMeshExport(int gridSize);
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+//One vertex of the curve or the spiral in a single interleaved vertex buffer: the position as three floats and the
+//color as four bytes, 16 bytes in all. The GPU fetches the position and the color of a vertex from the same 16 bytes,
+//instead of from two buffers in different places, and the color takes 4 bytes instead of 12.
+//The color bytes are read with glVertexAttribPointer(..., GL_UNSIGNED_BYTE, GL_TRUE, ...), which turns them back into
+//0..1 for the shader. The curve has no z, which is then 0
+struct PackedVertex
+{
+    float x;
+    float y;
+    float z;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t alpha;
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be 16 bytes");
+
+//A color from 0 to 1 as a byte from 0 to 255
+inline uint8_t colorByte(float value)
+{
+    return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f));
+}
+
+//Packs the vertices from 'positions', with 'dimensions' (2 or 3) floats for each vertex, and 'colors', with r, g, b
+//for each vertex
+inline std::vector<PackedVertex> packVertices(const std::vector<float>& positions, int dimensions,
+    const std::vector<float>& colors)
+{
+    size_t count = positions.size() / dimensions;
+    std::vector<PackedVertex> vertices(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        PackedVertex& vertex = vertices[i];
+        vertex.x = positions[i * dimensions];
+        vertex.y = positions[i * dimensions + 1];
+        vertex.z = dimensions > 2 ? positions[i * dimensions + 2] : 0.0f;
+        vertex.red = colorByte(colors[3 * i]);
+        vertex.green = colorByte(colors[3 * i + 1]);
+        vertex.blue = colorByte(colors[3 * i + 2]);
+        vertex.alpha = 255;
+    }
+    return vertices;
+}
@@ -0,0 +1,119 @@
+#include "ParallelText.h"
+#include "MappedFile.h"
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+using namespace std;
+
+void writeLinesInParallel(TextWriter& file, size_t lineCount, ThreadPool& pool,
+    const function<void(TextWriter&, size_t)>& formatLine, size_t linesPerPart)
+{
+    //With one thread the lines are formatted straight into the file, without the copy from the parts
+    if (pool.size() == 1)
+    {
+        for (size_t i = 0; i < lineCount; ++i)
+        {
+            formatLine(file, i);
+        }
+        return;
+    }
+
+    linesPerPart = max<size_t>(linesPerPart, 1);
+    size_t partCount = (lineCount + linesPerPart - 1) / linesPerPart;
+
+    //The buffers are kept from one round to the next, so they only grow to their size once
+    size_t partsInRound = 4 * static_cast<size_t>(pool.size());
+    vector<unique_ptr<TextWriter>> parts(min(partsInRound, partCount));
+    for (unique_ptr<TextWriter>& part : parts)
+    {
+        part.reset(new TextWriter());
+    }
+
+    for (size_t firstPart = 0; firstPart < partCount; firstPart += parts.size())
+    {
+        size_t roundSize = min(parts.size(), partCount - firstPart);
+        pool.parallelFor(roundSize, [&](size_t p)
+        {
+            TextWriter& text = *parts[p];
+            text.clear();
+            size_t first = (firstPart + p) * linesPerPart;
+            size_t last = min(first + linesPerPart, lineCount);
+            for (size_t i = first; i < last; ++i)
+            {
+                formatLine(text, i);
+            }
+        });
+        for (size_t p = 0; p < roundSize; ++p)
+        {
+            file.write(parts[p]->text(), parts[p]->length());
+        }
+    }
+}
+
+void benchmarkParallelText(size_t numberOfLines)
+{
+    //Points on the Oppgave3 surface, so the numbers have the same kind of digits as the real file
+    auto formatLine = [](TextWriter& text, size_t i)
+    {
+        float x = static_cast<float>(-2.0 + 4.0 * (i / 1000) / 999.0);
+        float y = static_cast<float>(-2.0 + 4.0 * (i % 1000) / 999.0);
+        float z = static_cast<float>(2.0 * x * x * y);
+        float color = static_cast<float>((x + 1.0) / 2.0);
+        text << "x: " << x << " y: " << y << " z: " << z <<
+            " red: " << color << " green: " << color << " blue: " << color << '\n';
+    };
+
+    //The file written one line after the other, to compare with
+    const char* singlePath = "ParallelTextSingle.txt";
+    const char* parallelPath = "ParallelTextBenchmark.txt";
+    auto begin = chrono::steady_clock::now();
+    {
+        TextWriter file(singlePath);
+        for (size_t i = 0; i < numberOfLines; ++i)
+        {
+            formatLine(file, i);
+        }
+    }
+    double singleSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    cout << "Lines written one after the other: " << numberOfLines / singleSeconds << " lines/second" << endl;
+
+    unsigned int cores = max(thread::hardware_concurrency(), 1u);
+    for (unsigned int threads = 1; ; threads = min(2 * threads, cores))
+    {
+        ThreadPool pool(threads);
+        auto begin = chrono::steady_clock::now();
+        {
+            TextWriter file(parallelPath);
+            writeLinesInParallel(file, numberOfLines, pool, formatLine);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        bool same = false;
+        try
+        {
+            MappedFile single(singlePath);
+            MappedFile parallel(parallelPath);
+            same = single.size() == parallel.size() && memcmp(single.data(), parallel.data(), single.size()) == 0;
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to compare the files: " << error.what() << endl;
+        }
+        cout << "Lines formatted on " << threads << " threads: " << numberOfLines / seconds << " lines/second, "
+            << singleSeconds / seconds << "x, " << (same ? "the same file" : "NOT the same file") << endl;
+
+        if (threads == cores)
+        {
+            break;
+        }
+    }
+
+    remove(singlePath);
+    remove(parallelPath);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <functional>
+#include <cstddef>
+#include "TextWriter.h"
+#include "ThreadPool.h"
+
+//Formats 'lineCount' lines on the threads of the pool and writes them to 'file' in order. formatLine(text, i) writes
+//line i to 'text', a TextWriter without a file.
+//The lines are split into parts of linesPerPart lines. Each part is formatted into its own buffer, and the buffers are
+//written to the file in the order of the parts, so the file is exactly the same as when the lines are written one
+//after the other. Only a few parts for each thread are formatted at a time, so the memory used does not grow with the
+//number of lines. A pool with one thread formats straight into the file
+void writeLinesInParallel(TextWriter& file, size_t lineCount, ThreadPool& pool,
+    const std::function<void(TextWriter&, size_t)>& formatLine, size_t linesPerPart = 16384);
+
+//Writes 'numberOfLines' lines in the format of the Oppgave3 Data.txt with 1, 2, 4 ... threads up to one for each core,
+//and prints the lines per second for each and if the file is the same as with one thread. The files are deleted
+//afterwards
+void benchmarkParallelText(size_t numberOfLines);
@@ -0,0 +1,149 @@
+#include "QuantizedVertex.h"
+#include "PackedVertex.h"
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+namespace
+{
+    const float snormLargest = 32767.0f;
+
+    //The value of coordinate c of a vertex as the GPU reads it, before the scale is used
+    float storedValue(const QuantizedVertex& vertex, int c, PositionEncoding encoding)
+    {
+        uint16_t bits = c == 0 ? vertex.x : c == 1 ? vertex.y : vertex.z;
+        if (encoding == PositionEncoding::HalfFloat)
+        {
+            return halfToFloat(bits);
+        }
+        return static_cast<float>(static_cast<int16_t>(bits));
+    }
+}
+
+uint16_t floatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    //Infinity and NaN
+    if (magnitude >= 0x7f800000)
+    {
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    }
+    //65520 and more is closer to infinity than to 65504, the largest half
+    if (magnitude >= 0x477ff000)
+    {
+        return sign | 0x7c00;
+    }
+    //Below 2^-14 a half has no exponent left, and counts in steps of 2^-24
+    if (magnitude < 0x38800000)
+    {
+        return sign | static_cast<uint16_t>(lrintf(fabsf(value) * 16777216.0f));
+    }
+    //Moves the exponent from the float bias 127 to the half bias 15, and rounds the 13 bits that are cut off.
+    //A mantissa that rounds up past the top correctly moves into the exponent
+    uint32_t half = (magnitude >> 13) - ((127 - 15) << 10);
+    uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1) != 0))
+    {
+        ++half;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+float halfToFloat(uint16_t value)
+{
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    if (exponent == 0)
+    {
+        float magnitude = ldexpf(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -magnitude : magnitude;
+    }
+    uint32_t bits = sign | (exponent == 31 ? 0x7f800000 | (mantissa << 13) : ((exponent + 112) << 23) | (mantissa << 13));
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+vector<QuantizedVertex> packQuantizedVertices(const vector<float>& positions, int dimensions,
+    const vector<float>& colors, PositionEncoding encoding, PositionScale& scale)
+{
+    size_t count = positions.size() / dimensions;
+    scale = PositionScale();
+    if (encoding == PositionEncoding::Snorm16 && count > 0)
+    {
+        //The box around all the positions. Its middle becomes 0 and its sides become -32767 and 32767
+        for (int c = 0; c < dimensions; ++c)
+        {
+            float smallest = positions[c];
+            float largest = positions[c];
+            for (size_t i = 1; i < count; ++i)
+            {
+                smallest = min(smallest, positions[i * dimensions + c]);
+                largest = max(largest, positions[i * dimensions + c]);
+            }
+            scale.center[c] = 0.5f * (smallest + largest);
+            float halfSize = 0.5f * (largest - smallest);
+            scale.scale[c] = halfSize > 0.0f ? halfSize / snormLargest : 1.0f;
+        }
+    }
+
+    vector<QuantizedVertex> vertices(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        QuantizedVertex& vertex = vertices[i];
+        uint16_t stored[3] = { 0, 0, 0 };
+        for (int c = 0; c < dimensions; ++c)
+        {
+            float value = positions[i * dimensions + c];
+            if (encoding == PositionEncoding::HalfFloat)
+            {
+                stored[c] = floatToHalf(value);
+            }
+            else
+            {
+                float steps = roundf((value - scale.center[c]) / scale.scale[c]);
+                stored[c] = static_cast<uint16_t>(static_cast<int16_t>(min(max(steps, -snormLargest), snormLargest)));
+            }
+        }
+        vertex.x = stored[0];
+        vertex.y = stored[1];
+        vertex.z = stored[2];
+        vertex.unused = 0;
+        vertex.red = colorByte(colors[3 * i]);
+        vertex.green = colorByte(colors[3 * i + 1]);
+        vertex.blue = colorByte(colors[3 * i + 2]);
+        vertex.alpha = 255;
+    }
+    return vertices;
+}
+
+QuantizationError quantizationError(const vector<QuantizedVertex>& vertices, const vector<float>& positions,
+    int dimensions, PositionEncoding encoding, const PositionScale& scale)
+{
+    QuantizationError error;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        double squaredDistance = 0.0;
+        for (int c = 0; c < dimensions; ++c)
+        {
+            //The same float calculation as in the shader
+            float restored = scale.center[c] + scale.scale[c] * storedValue(vertices[i], c, encoding);
+            double difference = static_cast<double>(restored) - positions[i * dimensions + c];
+            squaredDistance += difference * difference;
+        }
+        double distance = sqrt(squaredDistance);
+        error.largest = max(error.largest, distance);
+        error.average += distance;
+    }
+    if (!vertices.empty())
+    {
+        error.average /= static_cast<double>(vertices.size());
+    }
+    return error;
+}
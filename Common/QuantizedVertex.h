@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//How the positions are stored in the vertex buffer
+enum class PositionEncoding
+{
+    Float, //Three 32-bit floats, as in PackedVertex
+    HalfFloat, //Three 16-bit floats (GL_HALF_FLOAT). About 3 correct digits, so the error grows with the distance from 0
+    Snorm16 //Three 16-bit integers from -32767 to 32767 across the box around all the positions (GL_SHORT)
+};
+
+//A PackedVertex with the position as 16-bit numbers: 12 bytes instead of 16. The fourth number is not used, it only
+//keeps the color at a multiple of 4 bytes, which the GPU reads fastest
+struct QuantizedVertex
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t z;
+    uint16_t unused;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t alpha;
+};
+static_assert(sizeof(QuantizedVertex) == 12, "QuantizedVertex must be 12 bytes");
+
+//How the vertex shader gets the position back: position = center + scale * value, where value is the number the GPU
+//reads from the buffer. Half floats are read as they are, so their center is 0 and their scale is 1.
+//The numbers are given to the shader as the uniforms positionCenter and positionScale
+struct PositionScale
+{
+    float center[3] = { 0.0f, 0.0f, 0.0f };
+    float scale[3] = { 1.0f, 1.0f, 1.0f };
+};
+
+//Converts a float to the nearest half float (ties to even), and back. Numbers too large for a half become infinity
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+//Packs the vertices from 'positions', with 'dimensions' (2 or 3) floats for each vertex, and 'colors', with r, g, b for
+//each vertex. 'encoding' is HalfFloat or Snorm16, and 'scale' is set to what the shader needs
+std::vector<QuantizedVertex> packQuantizedVertices(const std::vector<float>& positions, int dimensions,
+    const std::vector<float>& colors, PositionEncoding encoding, PositionScale& scale);
+
+//The distance between the positions the shader gets back from 'vertices' and the float positions they were made from
+struct QuantizationError
+{
+    double largest = 0.0;
+    double average = 0.0;
+};
+QuantizationError quantizationError(const std::vector<QuantizedVertex>& vertices, const std::vector<float>& positions,
+    int dimensions, PositionEncoding encoding, const PositionScale& scale);
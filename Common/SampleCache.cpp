@@ -0,0 +1,159 @@
+#include "SampleCache.h"
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+using namespace std;
+namespace fs = std::filesystem;
+
+namespace
+{
+    const char entryExtension[] = ".bin";
+    const char statisticsFile[] = "statistics.txt";
+
+    //An entry in the folder and when it was last used
+    struct Entry
+    {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uint64_t size;
+    };
+
+    vector<Entry> listEntries(const string& directory)
+    {
+        vector<Entry> entries;
+        error_code error;
+        for (const fs::directory_entry& item : fs::directory_iterator(directory, error))
+        {
+            if (item.is_regular_file(error) && item.path().extension() == entryExtension)
+            {
+                entries.push_back({ item.path(), item.last_write_time(error), item.file_size(error) });
+            }
+        }
+        return entries;
+    }
+}
+
+SampleKey::SampleKey(const string& function)
+    : description("function=" + function)
+{
+}
+
+SampleKey& SampleKey::add(const string& name, double value)
+{
+    //The shortest text that reads back to exactly the same double, so two different values never give the same text
+    char text[32];
+    to_chars_result result = to_chars(text, text + sizeof(text), value);
+    return add(name, string(text, result.ptr));
+}
+
+SampleKey& SampleKey::add(const string& name, long long value)
+{
+    return add(name, to_string(value));
+}
+
+SampleKey& SampleKey::add(const string& name, const string& value)
+{
+    description += ";" + name + "=" + value;
+    return *this;
+}
+
+uint64_t SampleKey::hash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (char character : description)
+    {
+        hash ^= static_cast<unsigned char>(character);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+SampleCache::SampleCache(const string& directory, uint64_t sizeLimit)
+    : directory(directory), sizeLimit(sizeLimit)
+{
+    fs::create_directories(directory);
+
+    ifstream statistics(fs::path(directory) / statisticsFile);
+    string name;
+    statistics >> name >> hitCount >> name >> missCount >> name >> evictionCount;
+}
+
+string SampleCache::entryPath(const SampleKey& key) const
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key.hash()));
+    return (fs::path(directory) / (string(name) + entryExtension)).string();
+}
+
+bool SampleCache::find(const SampleKey& key, string& path)
+{
+    path = entryPath(key);
+    error_code error;
+    bool found = fs::is_regular_file(path, error);
+    if (found)
+    {
+        ++hitCount;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+    }
+    else
+    {
+        ++missCount;
+    }
+    saveStatistics();
+    return found;
+}
+
+void SampleCache::store(const SampleKey& key)
+{
+    string newest = entryPath(key);
+    error_code error;
+    fs::last_write_time(newest, fs::file_time_type::clock::now(), error);
+
+    vector<Entry> entries = listEntries(directory);
+    uint64_t total = 0;
+    for (const Entry& entry : entries)
+    {
+        total += entry.size;
+    }
+    sort(entries.begin(), entries.end(), [](const Entry& left, const Entry& right)
+    {
+        return left.lastUsed < right.lastUsed;
+    });
+
+    for (const Entry& entry : entries)
+    {
+        if (total <= sizeLimit)
+        {
+            break;
+        }
+        if (entry.path == fs::path(newest))
+        {
+            continue;
+        }
+        if (fs::remove(entry.path, error))
+        {
+            total -= entry.size;
+            ++evictionCount;
+        }
+    }
+    saveStatistics();
+}
+
+uint64_t SampleCache::size() const
+{
+    uint64_t total = 0;
+    for (const Entry& entry : listEntries(directory))
+    {
+        total += entry.size;
+    }
+    return total;
+}
+
+void SampleCache::saveStatistics() const
+{
+    ofstream statistics(fs::path(directory) / statisticsFile);
+    statistics << "hits " << hitCount << "\nmisses " << missCount << "\nevictions " << evictionCount << '\n';
+}
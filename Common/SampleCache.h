@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+//Describes what was sampled: the function and every setting that changes the samples, for example the domain, the
+//number of points and the precision. Two runs with the same description make the same samples.
+//The description is written as text ("function=x^2;a=-2;b=2;...") and hashed with 64-bit FNV-1a
+class SampleKey
+{
+public:
+    //'function' is the expression text, or a name for a built in C++ function. The name should be changed when the
+    //C++ function is changed, since the cache can not see that
+    explicit SampleKey(const std::string& function);
+
+    SampleKey& add(const std::string& name, double value);
+    SampleKey& add(const std::string& name, long long value);
+    SampleKey& add(const std::string& name, const std::string& value);
+
+    const std::string& text() const { return description; }
+    uint64_t hash() const;
+
+private:
+    std::string description;
+};
+
+//A folder with samples that were saved by earlier runs, one Data.bin file (see Dataset.h) for each SampleKey. The files
+//are named after the hash of the key, so finding the samples for a key is a single file lookup.
+//
+//The time a file was last used is kept as its modification time. When the files take more than sizeLimit bytes, the
+//ones that were used longest ago are deleted (least recently used). The number of hits and misses is kept in the file
+//statistics.txt in the folder, so it counts over all runs.
+//
+//The constructor throws runtime_error (filesystem_error) when the folder can not be made
+class SampleCache
+{
+public:
+    explicit SampleCache(const std::string& directory = "SampleCache", uint64_t sizeLimit = 256ull << 20);
+
+    //Returns true and the path of the samples when the key has been stored before, and marks them as just used.
+    //Counts a hit or a miss
+    bool find(const SampleKey& key, std::string& path);
+
+    //The path the samples for the key should be written to
+    std::string entryPath(const SampleKey& key) const;
+
+    //Call after the samples have been written to entryPath(key). Deletes the least recently used samples until
+    //everything fits in the size limit. The new samples are kept even when they alone are larger than the limit
+    void store(const SampleKey& key);
+
+    //The counts over all runs that have used the folder
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+    uint64_t evictions() const { return evictionCount; }
+
+    //The total size of the samples in the folder in bytes
+    uint64_t size() const;
+
+private:
+    void saveStatistics() const;
+
+    std::string directory;
+    uint64_t sizeLimit;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+    uint64_t evictionCount = 0;
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include <cstring>
+#include <cmath>
+
+//Small vector types that hold 2 (SSE) or 4 (AVX2) doubles and support the same arithmetic as a double.
+//This lets the function templates in Function.h and the Dual type in Dual.h be instantiated on a whole SIMD register,
+//so one call evaluates several points at once
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define SIMD_DOUBLE_X86 1
+#include <immintrin.h>
+#endif
+
+//GCC and Clang only let us use the AVX2 and SSE4 instructions inside functions that are marked with the instruction set.
+//FLATTEN makes the compiler inline the function templates and the operators into the marked kernel.
+//Visual Studio allows the intrinsics everywhere, so there the macros are empty
+#if defined(SIMD_DOUBLE_X86) && defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE4 __attribute__((target("sse4.1")))
+#define FLATTEN __attribute__((flatten))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE4
+#define FLATTEN
+#endif
+
+#ifdef SIMD_DOUBLE_X86
+
+#if defined(__GNUC__)
+//GCC and Clang have built in vector types where +, -, * and / (also with a double) already work lane by lane
+typedef double Double2 __attribute__((vector_size(16)));
+typedef double Double4 __attribute__((vector_size(32)));
+
+#pragma GCC diagnostic push
+//The vector types are only passed by value between inlined functions, so the ABI warning about AVX arguments does not matter
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+template<typename Vec>
+inline Vec loadVec(const double* p)
+{
+    Vec v;
+    memcpy(&v, p, sizeof(Vec));
+    return v;
+}
+
+template<typename Vec>
+inline void storeVec(double* p, Vec v)
+{
+    memcpy(p, &v, sizeof(Vec));
+}
+
+template<typename Vec>
+inline Vec broadcastVec(double value)
+{
+    return Vec{} + value;
+}
+
+#else
+//Visual Studio has no vector types with operators, so the intrinsics are wrapped in small structs
+struct Double2
+{
+    __m128d v;
+};
+
+struct Double4
+{
+    __m256d v;
+};
+
+inline Double2 operator+(Double2 a, Double2 b) { return { _mm_add_pd(a.v, b.v) }; }
+inline Double2 operator-(Double2 a, Double2 b) { return { _mm_sub_pd(a.v, b.v) }; }
+inline Double2 operator*(Double2 a, Double2 b) { return { _mm_mul_pd(a.v, b.v) }; }
+inline Double2 operator/(Double2 a, Double2 b) { return { _mm_div_pd(a.v, b.v) }; }
+inline Double2 operator-(Double2 a) { return { _mm_sub_pd(_mm_setzero_pd(), a.v) }; }
+inline Double2 operator+(Double2 a, double b) { return a + Double2{ _mm_set1_pd(b) }; }
+inline Double2 operator-(Double2 a, double b) { return a - Double2{ _mm_set1_pd(b) }; }
+inline Double2 operator*(Double2 a, double b) { return a * Double2{ _mm_set1_pd(b) }; }
+inline Double2 operator/(Double2 a, double b) { return a / Double2{ _mm_set1_pd(b) }; }
+inline Double2 operator+(double a, Double2 b) { return Double2{ _mm_set1_pd(a) } + b; }
+inline Double2 operator-(double a, Double2 b) { return Double2{ _mm_set1_pd(a) } - b; }
+inline Double2 operator*(double a, Double2 b) { return Double2{ _mm_set1_pd(a) } * b; }
+inline Double2 operator/(double a, Double2 b) { return Double2{ _mm_set1_pd(a) } / b; }
+
+inline Double4 operator+(Double4 a, Double4 b) { return { _mm256_add_pd(a.v, b.v) }; }
+inline Double4 operator-(Double4 a, Double4 b) { return { _mm256_sub_pd(a.v, b.v) }; }
+inline Double4 operator*(Double4 a, Double4 b) { return { _mm256_mul_pd(a.v, b.v) }; }
+inline Double4 operator/(Double4 a, Double4 b) { return { _mm256_div_pd(a.v, b.v) }; }
+inline Double4 operator-(Double4 a) { return { _mm256_sub_pd(_mm256_setzero_pd(), a.v) }; }
+inline Double4 operator+(Double4 a, double b) { return a + Double4{ _mm256_set1_pd(b) }; }
+inline Double4 operator-(Double4 a, double b) { return a - Double4{ _mm256_set1_pd(b) }; }
+inline Double4 operator*(Double4 a, double b) { return a * Double4{ _mm256_set1_pd(b) }; }
+inline Double4 operator/(Double4 a, double b) { return a / Double4{ _mm256_set1_pd(b) }; }
+inline Double4 operator+(double a, Double4 b) { return Double4{ _mm256_set1_pd(a) } + b; }
+inline Double4 operator-(double a, Double4 b) { return Double4{ _mm256_set1_pd(a) } - b; }
+inline Double4 operator*(double a, Double4 b) { return Double4{ _mm256_set1_pd(a) } * b; }
+inline Double4 operator/(double a, Double4 b) { return Double4{ _mm256_set1_pd(a) } / b; }
+
+template<typename Vec>
+Vec loadVec(const double* p);
+template<>
+inline Double2 loadVec<Double2>(const double* p) { return { _mm_loadu_pd(p) }; }
+template<>
+inline Double4 loadVec<Double4>(const double* p) { return { _mm256_loadu_pd(p) }; }
+
+inline void storeVec(double* p, Double2 v) { _mm_storeu_pd(p, v.v); }
+inline void storeVec(double* p, Double4 v) { _mm256_storeu_pd(p, v.v); }
+
+template<typename Vec>
+Vec broadcastVec(double value);
+template<>
+inline Double2 broadcastVec<Double2>(double value) { return { _mm_set1_pd(value) }; }
+template<>
+inline Double4 broadcastVec<Double4>(double value) { return { _mm256_set1_pd(value) }; }
+#endif
+
+//Integer powers are calculated with multiplications, in the same way as pow(x, n) for a Dual.
+//A negative n gives 1 / x^-n
+inline Double2 pow(Double2 x, int n)
+{
+    Double2 result = broadcastVec<Double2>(1.0);
+    for (int i = 0; i < n || i < -n; ++i)
+    {
+        result = result * x;
+    }
+    return n < 0 ? broadcastVec<Double2>(1.0) / result : result;
+}
+
+inline Double4 pow(Double4 x, int n)
+{
+    Double4 result = broadcastVec<Double4>(1.0);
+    for (int i = 0; i < n || i < -n; ++i)
+    {
+        result = result * x;
+    }
+    return n < 0 ? broadcastVec<Double4>(1.0) / result : result;
+}
+
+//Calls f for each lane of x. Used for the functions that have no SIMD instruction
+template<typename Vec, typename F>
+inline Vec eachLane(Vec x, F f)
+{
+    double lanes[sizeof(Vec) / sizeof(double)];
+    storeVec(lanes, x);
+    for (double& lane : lanes)
+    {
+        lane = f(lane);
+    }
+    return loadVec<Vec>(lanes);
+}
+
+//A power that is not a whole number, for example pow(x, 0.5), can not be made with multiplications, so std::pow is
+//called for each lane. Without these the exponent would be cut to an int
+inline Double2 pow(Double2 x, double p) { return eachLane(x, [p](double v) { return std::pow(v, p); }); }
+inline Double4 pow(Double4 x, double p) { return eachLane(x, [p](double v) { return std::pow(v, p); }); }
+
+//The other functions that function(x) in Function.h can use, lane by lane. +, -, * and / still work on the whole
+//register, so a function with a few of these is still faster than one point at a time
+inline Double2 sqrt(Double2 x) { return eachLane(x, [](double v) { return std::sqrt(v); }); }
+inline Double2 exp(Double2 x) { return eachLane(x, [](double v) { return std::exp(v); }); }
+inline Double2 log(Double2 x) { return eachLane(x, [](double v) { return std::log(v); }); }
+inline Double2 sin(Double2 x) { return eachLane(x, [](double v) { return std::sin(v); }); }
+inline Double2 cos(Double2 x) { return eachLane(x, [](double v) { return std::cos(v); }); }
+
+inline Double4 sqrt(Double4 x) { return eachLane(x, [](double v) { return std::sqrt(v); }); }
+inline Double4 exp(Double4 x) { return eachLane(x, [](double v) { return std::exp(v); }); }
+inline Double4 log(Double4 x) { return eachLane(x, [](double v) { return std::log(v); }); }
+inline Double4 sin(Double4 x) { return eachLane(x, [](double v) { return std::sin(v); }); }
+inline Double4 cos(Double4 x) { return eachLane(x, [](double v) { return std::cos(v); }); }
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
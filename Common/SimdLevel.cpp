@@ -0,0 +1,76 @@
+#include "SimdLevel.h"
+#include "SimdDouble.h"
+
+#ifdef SIMD_DOUBLE_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+SimdLevel detectSimdLevel()
+{
+#ifdef SIMD_DOUBLE_X86
+    unsigned int info[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+    __cpuid(reinterpret_cast<int*>(info), 0);
+    unsigned int highestLeaf = info[0];
+    __cpuid(reinterpret_cast<int*>(info), 1);
+#else
+    unsigned int highestLeaf = __get_cpuid_max(0, nullptr);
+    __get_cpuid(1, &info[0], &info[1], &info[2], &info[3]);
+#endif
+    bool sse4 = (info[2] & (1u << 19)) != 0;
+    bool osxsave = (info[2] & (1u << 27)) != 0;
+    bool avx = (info[2] & (1u << 28)) != 0;
+
+    //AVX registers can only be used when the operating system saves them on a context switch (XCR0 bit 1 and 2)
+    bool avxEnabledByOs = false;
+    if (osxsave && avx)
+    {
+#ifdef _MSC_VER
+        unsigned long long xcr0 = _xgetbv(0);
+#else
+        unsigned int eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        unsigned long long xcr0 = (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+        avxEnabledByOs = (xcr0 & 0x6) == 0x6;
+    }
+
+    bool avx2 = false;
+    if (highestLeaf >= 7 && avxEnabledByOs)
+    {
+#ifdef _MSC_VER
+        __cpuidex(reinterpret_cast<int*>(info), 7, 0);
+#else
+        __cpuid_count(7, 0, info[0], info[1], info[2], info[3]);
+#endif
+        avx2 = (info[1] & (1u << 5)) != 0;
+    }
+
+    if (avx2)
+    {
+        return SimdLevel::AVX2;
+    }
+    if (sse4)
+    {
+        return SimdLevel::SSE4;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE4:
+        return "SSE4";
+    default:
+        return "Scalar";
+    }
+}
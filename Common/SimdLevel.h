@@ -0,0 +1,15 @@
+#pragma once
+
+//The instruction sets the SIMD kernels can use. The best one that the processor supports is chosen at runtime
+enum class SimdLevel
+{
+    Scalar,
+    SSE4,
+    AVX2
+};
+
+//Asks the processor (cpuid) and the operating system (xgetbv) which instruction sets can be used
+SimdLevel detectSimdLevel();
+
+//Returns the name of the instruction set, used when printing the benchmark results
+const char* simdLevelName(SimdLevel level);
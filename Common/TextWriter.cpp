@@ -0,0 +1,299 @@
+#include "TextWriter.h"
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+using namespace std;
+
+namespace
+{
+
+    FILE* openForWriting(const string& path)
+    {
+#ifdef _MSC_VER
+        //fopen is marked as unsafe by Visual Studio, which fails the build with SDL checks on
+        FILE* file = nullptr;
+        return fopen_s(&file, path.c_str(), "wb") == 0 ? file : nullptr;
+#else
+        return fopen(path.c_str(), "wb");
+#endif
+    }
+
+    string errorText(int error)
+    {
+#ifdef _MSC_VER
+        //strerror is marked as unsafe in the same way
+        char text[256];
+        strerror_s(text, sizeof(text), error);
+        return text;
+#else
+        return strerror(error);
+#endif
+    }
+}
+
+TextWriter::TextWriter(const string& path, size_t bufferSize, bool writeInBackground)
+    : path(path), file(openForWriting(path)), used(0)
+{
+    bufferSize = max(bufferSize, largestNumberLength);
+    if (file != nullptr)
+    {
+        //This class already buffers, so the C library should not copy everything once more
+        setvbuf(file, nullptr, _IONBF, 0);
+        if (writeInBackground)
+        {
+            backgroundWriter.reset(new BackgroundWriter(file, bufferSize));
+            buffer = backgroundWriter->takeBuffer();
+            return;
+        }
+    }
+    buffer.resize(bufferSize);
+}
+
+TextWriter::TextWriter()
+    : file(nullptr), inMemory(true), buffer(largestNumberLength), used(0)
+{
+}
+
+TextWriter::~TextWriter()
+{
+    try
+    {
+        close();
+    }
+    catch (const runtime_error&)
+    {
+        //The error can not be reported from a destructor. Call close() to see it
+    }
+}
+
+char* TextWriter::reserve(size_t length)
+{
+    if (used + length > buffer.size())
+    {
+        if (inMemory)
+        {
+            buffer.resize(max(2 * buffer.size(), used + length));
+        }
+        else
+        {
+            writeBuffer();
+        }
+    }
+    return buffer.data() + used;
+}
+
+void TextWriter::write(const char* text, size_t length)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    //Text that is longer than the whole buffer is copied one buffer at a time, so it stays in order with the rest
+    while (length > 0)
+    {
+        size_t part = min(length, buffer.size());
+        memcpy(reserve(part), text, part);
+        used += part;
+        text += part;
+        length -= part;
+    }
+}
+
+TextWriter& TextWriter::operator<<(const char* text)
+{
+    write(text, strlen(text));
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(const string& text)
+{
+    write(text.data(), text.size());
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(char character)
+{
+    write(&character, 1);
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(float value)
+{
+    if (!isOpen())
+    {
+        return *this;
+    }
+    //The data files repeat a lot of values (the same x for a whole row, r = g = b), so the text of the last number is
+    //kept and copied when the next one has exactly the same bits
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char* begin = reserve(largestNumberLength);
+    if (lastLength == 0 || bits != lastBits)
+    {
+        lastLength = to_chars(lastText, lastText + largestNumberLength, value).ptr - lastText;
+        lastBits = bits;
+    }
+    memcpy(begin, lastText, lastLength);
+    used += lastLength;
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(double value)
+{
+    return *this << static_cast<float>(value);
+}
+
+TextWriter& TextWriter::operator<<(int value)
+{
+    return *this << static_cast<long long>(value);
+}
+
+TextWriter& TextWriter::operator<<(long long value)
+{
+    if (isOpen())
+    {
+        char* begin = reserve(largestNumberLength);
+        used = to_chars(begin, begin + largestNumberLength, value).ptr - buffer.data();
+    }
+    return *this;
+}
+
+TextWriter& TextWriter::operator<<(size_t value)
+{
+    if (isOpen())
+    {
+        char* begin = reserve(largestNumberLength);
+        used = to_chars(begin, begin + largestNumberLength, value).ptr - buffer.data();
+    }
+    return *this;
+}
+
+void TextWriter::flush()
+{
+    writeBuffer();
+    throwFailure();
+}
+
+void TextWriter::writeBuffer()
+{
+    //Without a file the text stays in the buffer until it is taken out
+    if (inMemory)
+    {
+        return;
+    }
+    //After a failed write the file is missing a part, so the rest is not written
+    if (file != nullptr && used > 0 && failure.empty())
+    {
+        if (backgroundWriter)
+        {
+            backgroundWriter->write(move(buffer), used);
+            buffer = backgroundWriter->takeBuffer();
+            setFailure(backgroundWriter->error());
+        }
+        else
+        {
+            errno = 0;
+            if (fwrite(buffer.data(), 1, used, file) != used)
+            {
+                setFailure(errno != 0 ? errno : EIO);
+            }
+        }
+    }
+    used = 0;
+}
+
+void TextWriter::setFailure(int error)
+{
+    if (error != 0 && failure.empty())
+    {
+        failure = "Could not write " + path + ": " + errorText(error);
+    }
+}
+
+void TextWriter::throwFailure()
+{
+    if (!failure.empty())
+    {
+        throw runtime_error(failure);
+    }
+}
+
+void TextWriter::close()
+{
+    if (file == nullptr)
+    {
+        return;
+    }
+    writeBuffer();
+    if (backgroundWriter)
+    {
+        backgroundWriter->finish();
+        setFailure(backgroundWriter->error());
+        backgroundWriter.reset();
+    }
+    errno = 0;
+    if (fclose(file) != 0)
+    {
+        setFailure(errno != 0 ? errno : EIO);
+    }
+    file = nullptr;
+    throwFailure();
+}
+
+void benchmarkTextWriter(size_t numberOfLines)
+{
+    const char* path = "TextWriterBenchmark.txt";
+    //Points on the Oppgave3 surface, so the numbers have the same kind of digits as the real file
+    auto point = [](size_t i, double& x, double& y, double& z, double& color)
+    {
+        x = -2.0 + 4.0 * (i / 1000) / 999.0;
+        y = -2.0 + 4.0 * (i % 1000) / 999.0;
+        z = 2.0 * x * x * y;
+        color = (x + 1.0) / 2.0;
+    };
+
+    auto begin = chrono::steady_clock::now();
+    {
+        ofstream stream(path);
+        for (size_t i = 0; i < numberOfLines; ++i)
+        {
+            double x, y, z, color;
+            point(i, x, y, z, color);
+            stream << "x: " << x << " y: " << y << " z: " << z <<
+                " red: " << color << " green: " << color << " blue: " << color << endl;
+        }
+    }
+    double streamSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    auto writeLines = [&](bool writeInBackground)
+    {
+        auto begin = chrono::steady_clock::now();
+        {
+            TextWriter writer(path, 1 << 20, writeInBackground);
+            for (size_t i = 0; i < numberOfLines; ++i)
+            {
+                double x, y, z, color;
+                point(i, x, y, z, color);
+                writer << "x: " << x << " y: " << y << " z: " << z <<
+                    " red: " << color << " green: " << color << " blue: " << color << '\n';
+            }
+        }
+        return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    };
+    double writerSeconds = writeLines(false);
+    double backgroundSeconds = writeLines(true);
+
+    remove(path);
+
+    cout << "ofstream with endl: " << numberOfLines / streamSeconds << " lines/second" << endl;
+    cout << "TextWriter: " << numberOfLines / writerSeconds << " lines/second, "
+        << streamSeconds / writerSeconds << "x faster" << endl;
+    cout << "TextWriter with a background writer thread: " << numberOfLines / backgroundSeconds << " lines/second, "
+        << writerSeconds / backgroundSeconds << "x TextWriter on one thread" << endl;
+}
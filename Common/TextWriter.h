@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "BackgroundWriter.h"
+
+//Writes a text file through one large buffer, instead of ofstream with endl that flushes the file for every line.
+//Numbers are formatted with std::to_chars, which does not use the locale and is much faster than the stream operators.
+//A number is written with the fewest digits that read back to exactly the same float, since the values end up as
+//floats in the vertex buffers. The buffer is only written to the file when it is full and when the writer is closed.
+//
+//By default a full buffer is written by a BackgroundWriter thread while the next one is filled, so the program can go on
+//sampling while the disk is busy. The file then takes up to three buffers of memory.
+//
+//Like ofstream, nothing happens when the file can not be opened. isOpen() tells if it was.
+//A write that fails is remembered, and flush() and close() throw runtime_error for it, in the same way as BulkWriter.
+//The destructor can not throw, so call close() to see the error
+class TextWriter
+{
+public:
+    explicit TextWriter(const std::string& path, size_t bufferSize = 1 << 20, bool writeInBackground = true);
+
+    //Formats into memory instead of a file, for example to format parts of a file on several threads. The buffer grows
+    //as needed, and the text is then given to write() of a TextWriter with a file
+    TextWriter();
+    ~TextWriter();
+
+    TextWriter(const TextWriter&) = delete;
+    TextWriter& operator=(const TextWriter&) = delete;
+
+    bool isOpen() const { return file != nullptr || inMemory; }
+
+    //The text formatted so far when the writer has no file
+    const char* text() const { return buffer.data(); }
+    size_t length() const { return used; }
+    void clear() { used = 0; }
+
+    TextWriter& operator<<(const char* text);
+    TextWriter& operator<<(const std::string& text);
+    TextWriter& operator<<(char character);
+    TextWriter& operator<<(float value);
+    TextWriter& operator<<(double value);
+    TextWriter& operator<<(int value);
+    TextWriter& operator<<(long long value);
+    TextWriter& operator<<(size_t value);
+
+    //Writes 'length' bytes as they are
+    void write(const char* text, size_t length);
+
+    //Writes the buffer to the file, or hands it to the writer thread. Throws runtime_error when a write has failed,
+    //with the writer thread only for the buffers it has written so far
+    void flush();
+
+    //Writes the buffer, waits for the writer thread and closes the file. Throws runtime_error when a write has failed
+    void close();
+
+private:
+    //Makes room for at least 'length' more bytes and returns where they go
+    char* reserve(size_t length);
+
+    //The part of flush() that does not throw, used when the buffer is full
+    void writeBuffer();
+
+    //Keeps the first error number as the text of the failure
+    void setFailure(int error);
+
+    //Throws the first write error, if there was one
+    void throwFailure();
+
+    //The longest number to_chars can write: a float or a 64-bit integer with sign, digits and exponent
+    static constexpr size_t largestNumberLength = 32;
+
+    std::string path;
+    std::FILE* file;
+    bool inMemory = false;
+    std::string failure;
+    //Null when the buffers are written on the calling thread
+    std::unique_ptr<BackgroundWriter> backgroundWriter;
+    std::vector<char> buffer;
+    size_t used;
+    //The last float that was formatted and its text
+    uint32_t lastBits = 0;
+    char lastText[largestNumberLength];
+    size_t lastLength = 0;
+};
+
+//Writes 'numberOfLines' lines in the format of the Oppgave3 Data.txt, first with ofstream and endl and then with
+//TextWriter on one thread and with the background writer, and prints the lines per second for each.
+//The file is deleted afterwards
+void benchmarkTextWriter(size_t numberOfLines);
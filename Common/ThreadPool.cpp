@@ -0,0 +1,90 @@
+#include "ThreadPool.h"
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+    {
+        threadCount = thread::hardware_concurrency();
+    }
+    for (unsigned int i = 1; i < threadCount; ++i)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t)>& task)
+{
+    if (workers.empty() || count <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(stateMutex);
+        currentTask = &task;
+        taskCount = count;
+        nextTask = 0;
+        workersDone = 0;
+        ++generation;
+    }
+    wakeUp.notify_all();
+
+    //The calling thread helps with the tasks instead of only waiting
+    runTasks();
+
+    //Waits until every worker has left this loop, so none of them can use the task after it is gone
+    unique_lock<mutex> lock(stateMutex);
+    finished.wait(lock, [this] { return workersDone == workers.size(); });
+    currentTask = nullptr;
+}
+
+void ThreadPool::workerLoop()
+{
+    size_t seenGeneration = 0;
+    while (true)
+    {
+        {
+            unique_lock<mutex> lock(stateMutex);
+            wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping)
+            {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        {
+            lock_guard<mutex> lock(stateMutex);
+            ++workersDone;
+        }
+        finished.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    for (size_t i = nextTask++; i < taskCount; i = nextTask++)
+    {
+        (*currentTask)(i);
+    }
+}
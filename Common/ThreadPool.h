@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+
+//A fixed group of worker threads that run the parts of one loop at the same time.
+//The threads are started once and sleep between the loops, so a loop does not pay for starting threads
+class ThreadPool
+{
+public:
+    //Uses 'threadCount' threads including the thread that calls parallelFor. 0 means one thread for each core
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //The number of threads that run tasks, including the calling thread
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    //Runs task(i) for every i from 0 to count - 1 and returns when all of them are done. The free threads take the
+    //next index in turn, so the order the tasks run in changes from run to run. Each task must therefore only write
+    //to its own part of the result, then the result is the same every time
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex stateMutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+
+    const std::function<void(size_t)>* currentTask = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextTask{ 0 };
+    //Counts the loops, so a worker knows when a new one has started
+    size_t generation = 0;
+    size_t workersDone = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,115 @@
+#include "AdaptiveSampler.h"
+#include <queue>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+namespace
+{
+    //An interval between two samples, ordered by the chord error so the worst one is split first
+    struct Interval
+    {
+        size_t left;
+        size_t right;
+        double error;
+
+        bool operator<(const Interval& other) const { return error < other.error; }
+    };
+}
+
+double chordError(const CurveSample& left, const CurveSample& right)
+{
+    double width = right.x - left.x;
+    double slope = (right.y - left.y) / width;
+    return width / 4.0 * max(fabs(left.derivative - slope), fabs(right.derivative - slope));
+}
+
+vector<CurveSample> sampleAdaptive(const CurveFunction& f, double start, double end, double tolerance,
+    size_t maximumSamples, size_t initialIntervals)
+{
+    //The two ends are always sampled
+    maximumSamples = max<size_t>(2, maximumSamples);
+    initialIntervals = max<size_t>(1, min(initialIntervals, maximumSamples - 1));
+
+    vector<CurveSample> samples;
+    samples.reserve(maximumSamples);
+    for (size_t i = 0; i <= initialIntervals; ++i)
+    {
+        samples.push_back(f(start + (end - start) * i / initialIntervals));
+    }
+
+    priority_queue<Interval> intervals;
+    for (size_t i = 0; i < initialIntervals; ++i)
+    {
+        intervals.push({ i, i + 1, chordError(samples[i], samples[i + 1]) });
+    }
+
+    while (samples.size() < maximumSamples && !intervals.empty() && intervals.top().error > tolerance)
+    {
+        Interval worst = intervals.top();
+        intervals.pop();
+
+        //Splitting into 'parts' equal parts makes the error about parts^2 times smaller, so this is the number of parts
+        //that brings it below the tolerance. At least 2, and never more new points than the budget has left
+        size_t largestParts = maximumSamples - samples.size() + 1;
+        double wantedParts = ceil(sqrt(worst.error / tolerance));
+        size_t parts = wantedParts < largestParts ? max<size_t>(2, static_cast<size_t>(wantedParts)) : largestParts;
+
+        double left = samples[worst.left].x;
+        double width = samples[worst.right].x - left;
+        size_t previous = worst.left;
+        for (size_t k = 1; k < parts; ++k)
+        {
+            size_t current = samples.size();
+            samples.push_back(f(left + width * k / parts));
+            intervals.push({ previous, current, chordError(samples[previous], samples[current]) });
+            previous = current;
+        }
+        intervals.push({ previous, worst.right, chordError(samples[previous], samples[worst.right]) });
+    }
+
+    sort(samples.begin(), samples.end(), [](const CurveSample& p, const CurveSample& q) { return p.x < q.x; });
+    return samples;
+}
+
+size_t uniformSampleCount(const CurveFunction& f, double start, double end, double tolerance, size_t maximumCount)
+{
+    auto largestError = [&](size_t count)
+    {
+        double error = 0.0;
+        CurveSample previous = f(start);
+        for (size_t i = 1; i < count; ++i)
+        {
+            CurveSample current = f(start + (end - start) * i / (count - 1));
+            error = max(error, chordError(previous, current));
+            previous = current;
+        }
+        return error;
+    };
+
+    //Doubles the count until the error is small enough, then finds the smallest count with a binary search.
+    //Very few points can miss the shape completely (two points on a bump look flat), so the search starts at 9
+    size_t high = 9;
+    while (largestError(high) > tolerance)
+    {
+        if (high >= maximumCount)
+        {
+            return 0;
+        }
+        high = min(2 * high, maximumCount);
+    }
+    size_t low = max<size_t>(8, high / 2);
+    while (low + 1 < high)
+    {
+        size_t middle = (low + high) / 2;
+        if (largestError(middle) > tolerance)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return high;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+//One point on the curve with the derivative in that point
+struct CurveSample
+{
+    double x;
+    double y;
+    double derivative;
+};
+
+//Evaluates the function and the derivative in x
+typedef std::function<CurveSample(double x)> CurveFunction;
+
+//The largest distance in y between the straight line from left to right and the curve, estimated from the values and
+//derivatives in the two ends. Between the ends the curve is taken to be the cubic with the same values and derivatives,
+//and its distance from the line is at most width / 4 times the largest difference between an end derivative and the
+//slope of the line. So no new evaluations are needed to decide if an interval must be split
+double chordError(const CurveSample& left, const CurveSample& right);
+
+//Samples f from start to end where the curve bends. The interval is first split into 'initialIntervals' equal parts.
+//Then the part with the largest chord error is split again and again, until every part is below 'tolerance' or
+//'maximumSamples' points are used. The chord error shrinks with the square of the width, so the part is split into
+//ceil(sqrt(error / tolerance)) equal parts at once instead of in the middle. Every point is evaluated once and its
+//value and derivative are kept for the error of both neighbouring parts. The points are returned sorted by x
+std::vector<CurveSample> sampleAdaptive(const CurveFunction& f, double start, double end, double tolerance,
+    size_t maximumSamples, size_t initialIntervals = 8);
+
+//The number of equally spaced points that is needed for the same largest chord error, used to compare with the
+//adaptive sampling. Stops at 'maximumCount' points and returns 0 when even that many are not enough, so the comparison
+//never costs more than a few times the adaptive sampling
+size_t uniformSampleCount(const CurveFunction& f, double start, double end, double tolerance, size_t maximumCount);
@@ -0,0 +1,263 @@
+#include "BatchEvaluator.h"
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+using namespace std;
+
+#if defined(__GNUC__)
+//The kernels pass the SIMD types by value only between functions that are inlined into each other,
+//so the warning about the ABI for AVX arguments does not matter here
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#include "Function.h"
+
+//Newtons quotient in main.cpp. The benchmark uses it to measure the loop that calculatefunction() used before
+double differenceQuotient(double x);
+
+//The instruction set is only detected once, the first time it is needed
+static SimdLevel bestSimdLevel()
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+//Scalar kernels. Used when the processor has no SIMD support and for the points that are left over after the SIMD loops
+static void functionScalar(const double* x, double* y, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        y[i] = function(x[i]);
+    }
+}
+
+static void differenceQuotientScalar(const double* x, double* derivative, size_t count, double h)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        derivative[i] = (function(x[i] + h) - function(x[i])) / h;
+    }
+}
+
+static void functionAndDerivativeScalar(const double* x, double* y, double* derivative, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        Dual<double> result = function(Dual<double>::variable(x[i]));
+        y[i] = result.value;
+        derivative[i] = result.derivative();
+    }
+}
+
+#ifdef SIMD_DOUBLE_X86
+//The SIMD kernels instantiate the same function template as the scalar code on a whole register (Vec),
+//so they always evaluate the function that is defined in Function.h
+template<typename Vec>
+static void functionKernel(const double* x, double* y, size_t count)
+{
+    const size_t lanes = sizeof(Vec) / sizeof(double);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        storeVec(y + i, function(loadVec<Vec>(x + i)));
+    }
+    functionScalar(x + i, y + i, count - i);
+}
+
+template<typename Vec>
+static void differenceQuotientKernel(const double* x, double* derivative, size_t count, double h)
+{
+    const size_t lanes = sizeof(Vec) / sizeof(double);
+    Vec vh = broadcastVec<Vec>(h);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        Vec vx = loadVec<Vec>(x + i);
+        storeVec(derivative + i, (function(vx + vh) - function(vx)) / vh);
+    }
+    differenceQuotientScalar(x + i, derivative + i, count - i, h);
+}
+
+//Evaluates the function with a Dual where both the value and the derivative are SIMD registers
+template<typename Vec>
+static void functionAndDerivativeKernel(const double* x, double* y, double* derivative, size_t count)
+{
+    const size_t lanes = sizeof(Vec) / sizeof(double);
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes)
+    {
+        Dual<Vec> result = function(Dual<Vec>::variable(loadVec<Vec>(x + i)));
+        storeVec(y + i, result.value);
+        storeVec(derivative + i, result.derivative());
+    }
+    functionAndDerivativeScalar(x + i, y + i, derivative + i, count - i);
+}
+
+//AVX2 evaluates 4 points for each instruction
+TARGET_AVX2 FLATTEN static void functionAVX2(const double* x, double* y, size_t count)
+{
+    functionKernel<Double4>(x, y, count);
+}
+
+TARGET_AVX2 FLATTEN static void differenceQuotientAVX2(const double* x, double* derivative, size_t count, double h)
+{
+    differenceQuotientKernel<Double4>(x, derivative, count, h);
+}
+
+TARGET_AVX2 FLATTEN static void functionAndDerivativeAVX2(const double* x, double* y, double* derivative, size_t count)
+{
+    functionAndDerivativeKernel<Double4>(x, y, derivative, count);
+}
+
+//SSE4 evaluates 2 points for each instruction
+TARGET_SSE4 FLATTEN static void functionSSE4(const double* x, double* y, size_t count)
+{
+    functionKernel<Double2>(x, y, count);
+}
+
+TARGET_SSE4 FLATTEN static void differenceQuotientSSE4(const double* x, double* derivative, size_t count, double h)
+{
+    differenceQuotientKernel<Double2>(x, derivative, count, h);
+}
+
+TARGET_SSE4 FLATTEN static void functionAndDerivativeSSE4(const double* x, double* y, double* derivative, size_t count)
+{
+    functionAndDerivativeKernel<Double2>(x, y, derivative, count);
+}
+#endif
+
+void evaluateFunctionBatch(const double* x, double* y, size_t count)
+{
+    evaluateFunctionBatch(x, y, count, bestSimdLevel());
+}
+
+void evaluateFunctionBatch(const double* x, double* y, size_t count, SimdLevel level)
+{
+#ifdef SIMD_DOUBLE_X86
+    if (level == SimdLevel::AVX2)
+    {
+        functionAVX2(x, y, count);
+        return;
+    }
+    if (level == SimdLevel::SSE4)
+    {
+        functionSSE4(x, y, count);
+        return;
+    }
+#endif
+    functionScalar(x, y, count);
+}
+
+void differenceQuotientBatch(const double* x, double* derivative, size_t count, double h)
+{
+    differenceQuotientBatch(x, derivative, count, h, bestSimdLevel());
+}
+
+void differenceQuotientBatch(const double* x, double* derivative, size_t count, double h, SimdLevel level)
+{
+#ifdef SIMD_DOUBLE_X86
+    if (level == SimdLevel::AVX2)
+    {
+        differenceQuotientAVX2(x, derivative, count, h);
+        return;
+    }
+    if (level == SimdLevel::SSE4)
+    {
+        differenceQuotientSSE4(x, derivative, count, h);
+        return;
+    }
+#endif
+    differenceQuotientScalar(x, derivative, count, h);
+}
+
+void evaluateFunctionAndDerivativeBatch(const double* x, double* y, double* derivative, size_t count)
+{
+    evaluateFunctionAndDerivativeBatch(x, y, derivative, count, bestSimdLevel());
+}
+
+void evaluateFunctionAndDerivativeBatch(const double* x, double* y, double* derivative, size_t count, SimdLevel level)
+{
+#ifdef SIMD_DOUBLE_X86
+    if (level == SimdLevel::AVX2)
+    {
+        functionAndDerivativeAVX2(x, y, derivative, count);
+        return;
+    }
+    if (level == SimdLevel::SSE4)
+    {
+        functionAndDerivativeSSE4(x, y, derivative, count);
+        return;
+    }
+#endif
+    functionAndDerivativeScalar(x, y, derivative, count);
+}
+
+void benchmarkBatchEvaluator(size_t numberOfPoints)
+{
+    //The points are sampled in blocks, so the benchmark measures the evaluation and not the memory bandwidth
+    const size_t blockSize = 4096;
+    vector<double> x(blockSize), y(blockSize), derivative(blockSize);
+    const double start = -2.0;
+    const double step = 4.0 / numberOfPoints;
+    //Sums up the results so the compiler can not remove the loops
+    double checksum = 0.0;
+
+    auto pointsPerSecond = [numberOfPoints](chrono::steady_clock::time_point begin) {
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        return numberOfPoints / seconds;
+    };
+
+    //The loop that calculatefunction() used before: one call to function(x) and two more through differenceQuotient(x)
+    auto begin = chrono::steady_clock::now();
+    for (size_t i = 0; i < numberOfPoints; ++i)
+    {
+        double px = start + i * step;
+        checksum += function(px) + differenceQuotient(px);
+    }
+    double scalarRate = pointsPerSecond(begin);
+    cout << "Scalar loop: " << scalarRate << " points/second" << endl;
+
+    SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE4, SimdLevel::AVX2 };
+    for (SimdLevel level : levels)
+    {
+        if (level > bestSimdLevel())
+        {
+            continue;
+        }
+
+        begin = chrono::steady_clock::now();
+        for (size_t first = 0; first < numberOfPoints; first += blockSize)
+        {
+            size_t count = min(blockSize, numberOfPoints - first);
+            for (size_t i = 0; i < count; ++i)
+            {
+                x[i] = start + (first + i) * step;
+            }
+            evaluateFunctionBatch(x.data(), y.data(), count, level);
+            differenceQuotientBatch(x.data(), derivative.data(), count, 0.01, level);
+            checksum += y[0] + derivative[0];
+        }
+        double rate = pointsPerSecond(begin);
+        cout << "Batch " << simdLevelName(level) << ": " << rate << " points/second ("
+            << rate / scalarRate << "x the scalar loop)" << endl;
+
+        //The same points with the exact derivative from the dual numbers instead of Newtons quotient
+        begin = chrono::steady_clock::now();
+        for (size_t first = 0; first < numberOfPoints; first += blockSize)
+        {
+            size_t count = min(blockSize, numberOfPoints - first);
+            for (size_t i = 0; i < count; ++i)
+            {
+                x[i] = start + (first + i) * step;
+            }
+            evaluateFunctionAndDerivativeBatch(x.data(), y.data(), derivative.data(), count, level);
+            checksum += y[0] + derivative[0];
+        }
+        rate = pointsPerSecond(begin);
+        cout << "Batch " << simdLevelName(level) << " with dual numbers: " << rate << " points/second ("
+            << rate / scalarRate << "x the scalar loop)" << endl;
+    }
+
+    cout << "Checksum: " << checksum << endl;
+}
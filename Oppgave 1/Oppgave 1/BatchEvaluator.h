@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include "SimdLevel.h"
+
+//Evaluates f(x)= x^2 for 'count' x values at once and stores the results in y.
+//Uses the best instruction set found by detectSimdLevel()
+void evaluateFunctionBatch(const double* x, double* y, size_t count);
+void evaluateFunctionBatch(const double* x, double* y, size_t count, SimdLevel level);
+
+//Evaluates the Newtons quotient (f(x + h) - f(x)) / h for 'count' x values at once
+void differenceQuotientBatch(const double* x, double* derivative, size_t count, double h);
+void differenceQuotientBatch(const double* x, double* derivative, size_t count, double h, SimdLevel level);
+
+//Evaluates the function with a dual number, which gives the value and the exact derivative for 'count' x values in one pass
+void evaluateFunctionAndDerivativeBatch(const double* x, double* y, double* derivative, size_t count);
+void evaluateFunctionAndDerivativeBatch(const double* x, double* y, double* derivative, size_t count, SimdLevel level);
+
+//Samples 'numberOfPoints' points with the scalar loop and with every supported batch kernel
+//and prints how many points per second each of them manages
+void benchmarkBatchEvaluator(size_t numberOfPoints);
@@ -0,0 +1,18 @@
+#pragma once
+#include <cmath>
+#include "Dual.h"
+#include "SimdDouble.h"
+
+// Function f(x)= x^2
+//The function is written once as a template. With double it gives the value, with Dual<double> it also gives the
+//exact derivative, and with Double2/Double4 or Dual<Double4> it evaluates 2 or 4 points at the same time.
+//pow(x, n) works for every whole n, also below 0, and for powers like pow(x, 0.5). sqrt, exp, log, sin and cos work as
+//well
+template<typename T>
+T function(T x)
+{
+    //Makes pow, sin and the others for double visible next to the versions for Dual and the SIMD types. A using
+    //directive adds them to the others, where 'using std::pow' would hide the SIMD versions
+    using namespace std;
+    return pow(x, 2);
+}
@@ -0,0 +1,52 @@
+#include "GridDerivative.h"
+#include "BatchEvaluator.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+void gridDerivative(const double* values, size_t stride, size_t count, double h, double* derivatives)
+{
+    //With less than three points there is no stencil of the same order, so the best we can do is a plain difference
+    if (count < 3)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            derivatives[i] = count == 2 ? (values[stride] - values[0]) / h : 0.0;
+        }
+        return;
+    }
+
+    double twoH = 2.0 * h;
+    derivatives[0] = (-3.0 * values[0] + 4.0 * values[stride] - values[2 * stride]) / twoH;
+    for (size_t i = 1; i + 1 < count; ++i)
+    {
+        derivatives[i] = (values[(i + 1) * stride] - values[(i - 1) * stride]) / twoH;
+    }
+    size_t last = count - 1;
+    derivatives[last] = (3.0 * values[last * stride] - 4.0 * values[(last - 1) * stride] + values[(last - 2) * stride]) / twoH;
+}
+
+void reportGridDerivativeError(const double* x, const double* gridDerivatives, size_t count, double quotientStep)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    vector<double> quotients(count);
+    differenceQuotientBatch(x, quotients.data(), count, quotientStep);
+
+    double largestError = 0.0;
+    double sumOfErrors = 0.0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        double error = fabs(gridDerivatives[i] - quotients[i]);
+        largestError = max(largestError, error);
+        sumOfErrors += error;
+    }
+
+    cout << "Grid derivative compared to the Newtons quotient: largest difference " << largestError
+        << ", mean difference " << sumOfErrors / count << endl;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+//Builds the derivative for every point in a grid with the constant step h from the samples that are already calculated,
+//so the function does not have to be evaluated again.
+//values points to the first y value and stride is the number of doubles between two y values.
+//Inside the grid the central difference (y[i+1] - y[i-1]) / 2h is used, and at the two ends
+//the one-sided stencils (-3y[0] + 4y[1] - y[2]) / 2h and (3y[n] - 4y[n-1] + y[n-2]) / 2h. All three have error O(h^2)
+void gridDerivative(const double* values, size_t stride, size_t count, double h, double* derivatives);
+
+//Prints the largest and the mean difference between the grid derivative and the Newtons quotient with step 'quotientStep'
+void reportGridDerivativeError(const double* x, const double* gridDerivatives, size_t count, double quotientStep);
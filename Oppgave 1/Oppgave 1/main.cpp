@@ -2,10 +2,47 @@
 #include <fstream>
 #include <cmath>
 #include<vector>
+#include <string>
+#include <stdexcept>
+#include <memory>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "Function.h"
+#include "BatchEvaluator.h"
+#include "GridDerivative.h"
+#include "Expression.h"
+#include "AdaptiveSampler.h"
+#include "TextWriter.h"
+#include "Dataset.h"
+#include "SampleCache.h"
+#include "PackedVertex.h"
+#include <cstddef>
 using namespace std;
 
+//1 puts the position and the color of each vertex next to each other in one buffer, with the color as bytes
+//(see PackedVertex.h). 0 uses one float buffer for the positions and one for the colors, to compare with
+#define INTERLEAVED_VERTICES 1
+
+//Where the red or green color of each vertex comes from.
+//VertexColors uploads the r, g, b that calculatefunction() picked for each vertex.
+//DerivativeAttribute uploads the derivative as one float next to the position, and the vertex shader picks green when it
+//is above 0 and red otherwise.
+//NeighbourSlope uploads only the positions, and the vertex shader uses the vertex before and the vertex after to find if
+//the graph goes up or down there.
+//Data.txt and Data.bin still get the r, g, b columns for all three
+enum class ColorSource
+{
+    VertexColors,
+    DerivativeAttribute,
+    NeighbourSlope
+};
+ColorSource colorSource = ColorSource::VertexColors;
+
+//Set to true to let the vertex shader make the points of the graph from gl_VertexID, a and h, so no vertex buffer is
+//uploaded at all. Only used for function(x) with equal steps, since the shader has its own copy of the function.
+//Data.txt is still written from the samples on the CPU
+bool generateOnGpu = false;
+
 //Stores the coordinates x, y
 vector<float> verticesPositions;
 //Stores the color coordinates for every single vertex 
@@ -25,8 +62,53 @@ int n = 40;
 //Calculates the dissolution of h
 double h = (b - a) / n;
 
-// Opens the text file for writing
-ofstream file("Data.txt");
+//The function can be given as text, for example "x^2" or "sin(x)*x", and is then compiled when the program starts.
+//When it is empty the C++ function(x) in Function.h is used
+string functionExpression = "";
+
+//How the derivative for each vertex is calculated.
+//Automatic evaluates function(x) with a dual number, which gives the value and the exact derivative in one pass.
+//NewtonQuotient evaluates the function two more times for every point with differenceQuotient(x).
+//GridSamples uses the neighbouring points that are already sampled, so no extra evaluations are needed
+enum class DerivativeMode
+{
+    Automatic,
+    NewtonQuotient,
+    GridSamples
+};
+DerivativeMode derivativeMode = DerivativeMode::Automatic;
+//Prints how much the grid derivative differs from the Newtons quotient when GridSamples is used
+bool reportDerivativeError = true;
+
+//How the x values are chosen. Uniform uses numberOfDataPoints points with the step h. Adaptive puts more points where
+//the graph bends and fewer where it is straight, until the distance between the line strip and the graph is below
+//adaptiveTolerance everywhere or adaptiveBudget points are used. Adaptive always uses the exact derivative
+//(Newtons quotient for a function given as text), since the grid is not evenly spaced
+enum class SamplingMode
+{
+    Uniform,
+    Adaptive
+};
+SamplingMode samplingMode = SamplingMode::Uniform;
+double adaptiveTolerance = 1.0 / 300.0; //About one pixel in the 600 pixel high window
+size_t adaptiveBudget = 1000;
+
+//Set to true to also save the points in the binary file Data.bin, with one float column for each of
+//x, y, derivative, r, g, b (see Dataset.h)
+bool writeBinaryDataset = false;
+
+//Set to true to keep the samples in the folder SampleCache (see SampleCache.h). When the function and all the settings
+//above are the same as in an earlier run, the samples are read from there instead of being calculated again.
+//Change the name in sampleKey() when function(x) in Function.h is changed
+bool useSampleCache = false;
+
+//Set to true to measure how many points per second the batch evaluator manages compared to the scalar loop
+bool runBenchmarks = false;
+//Number of points that are sampled in the benchmark
+size_t numberOfBenchmarkPoints = 20000000;
+
+// Opens the text file for writing. TextWriter keeps the lines in a large buffer, so the file is not flushed for every line
+TextWriter file("Data.txt");
 
 //Is a string literal that contains the source code for a vertex shader. 
 const char* vertexShaderSource = 
@@ -36,12 +118,46 @@ const char* vertexShaderSource =
 " layout (location = 0) in vec2 aPos;\n"
 //Represents the color attributes of the vertex. Locatioon 1 is the location of the data 
 " layout (location = 1) in vec3 aColor;\n"
+//The derivative of the vertex, used when colorSource is DerivativeAttribute
+" layout (location = 2) in float aDerivative;\n"
+//The positions of the vertex before and the vertex after, used when colorSource is NeighbourSlope
+" layout (location = 3) in vec2 aPrevious;\n"
+" layout (location = 4) in vec2 aNext;\n"
+//The ColorSource as a number: 0 is VertexColors, 1 is DerivativeAttribute and 2 is NeighbourSlope
+" uniform int colorSource = 0;\n"
 //A variable called ourColor that will be used to pass color information from the vertex shader to the fragment shader. 
 " out vec3 ourColor;\n"
 //Calculates the final position of the vertex and assigns color to the vertex 
 "void main() {\n"
 "    gl_Position = vec4(aPos.x, aPos.y, 0.0, 1.0);\n"
-"    ourColor = aColor;\n"
+"    if (colorSource == 0) {\n"
+"        ourColor = aColor;\n"
+"    }\n"
+"    else {\n"
+//x grows from one vertex to the next, so the graph goes up when the vertex after is higher than the vertex before
+"        float slope = colorSource == 1 ? aDerivative : aNext.y - aPrevious.y;\n"
+"        ourColor = slope > 0.0 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);\n"
+"    }\n"
+"}\0";
+
+//The vertex shader used when generateOnGpu is set. It has no inputs: vertex i of the draw is the point x = a + i * h.
+//function must be the same as function(x) in Function.h
+const char* generatingVertexShaderSource =
+" #version 330 core\n"
+//The start of the definition quantity and the step between the points
+" uniform float a;\n"
+" uniform float h;\n"
+" out vec3 ourColor;\n"
+//x * x instead of pow(x, 2.0), since pow is not defined for x below 0 in GLSL
+" float function(float x) {\n"
+"    return x * x;\n"
+" }\n"
+"void main() {\n"
+"    float x = a + float(gl_VertexID) * h;\n"
+"    gl_Position = vec4(x, function(x), 0.0, 1.0);\n"
+//The graph goes up when the point one step after is higher than the point one step before. Green up, red down
+"    float slope = function(x + h) - function(x - h);\n"
+"    ourColor = slope > 0.0 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);\n"
 "}\0";
 
 const char* fragmentShaderSource =
@@ -59,9 +175,15 @@ const char* fragmentShaderSource =
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow* window);
 
-double function(double x);
 double differenceQuotient(double x);
 void calculatefunction();
+void saveVertex(float x, float y, float derivative, float red, float green, float blue);
+void uploadShaderColoredVertices(unsigned int shaderProgram);
+SampleKey sampleKey();
+void saveBinaryDataset(const string& path);
+void loadBinaryDataset(const string& path);
+void sampleExpression(const vector<double>& xValues, vector<double>& yValues, vector<double>& derivatives);
+void sampleAdaptiveCurve(vector<double>& xValues, vector<double>& yValues, vector<double>& derivatives);
 
 int main(void)
 {
@@ -107,6 +229,13 @@ int main(void)
     //This function is called automatecally when the window is resized. 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    //The shader only knows function(x) in Function.h and equal steps
+    bool gpuGeneration = generateOnGpu && functionExpression.empty() && samplingMode == SamplingMode::Uniform;
+    if (generateOnGpu && !gpuGeneration)
+    {
+        cout << "Only function(x) with equal steps can be made on the GPU, so the vertices are uploaded" << endl;
+    }
+
     // Declares three variables 
     unsigned int vertexShader, fragmentShader, shaderProgram;
     //Creates a vertex shader object and the variable 'vertexShader' is assigned to the vartex shader object. 
@@ -115,7 +244,7 @@ int main(void)
     //1 is number of strings in the vertexShaderSource array. 
     //&vertexShaderSource is the pointer to a string containing the vertex shader source. 
     //0- the source code is null terminated. 
-    glShaderSource(vertexShader, 1, &vertexShaderSource, 0);
+    glShaderSource(vertexShader, 1, gpuGeneration ? &generatingVertexShaderSource : &vertexShaderSource, 0);
     //Compiles the shader code associated with the specified shader object. 
     glCompileShader(vertexShader);
     //Checks for compilation errors. 
@@ -163,32 +292,137 @@ int main(void)
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    calculatefunction();
+    //Looks for the same samples from an earlier run first
+    unique_ptr<SampleCache> cache;
+    bool cached = false;
+    if (useSampleCache)
+    {
+        try
+        {
+            cache.reset(new SampleCache());
+            string path;
+            if (cache->find(sampleKey(), path))
+            {
+                loadBinaryDataset(path);
+                cached = true;
+            }
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to use the sample cache: " << error.what() << endl;
+        }
+    }
+
+    if (!cached)
+    {
+        try
+        {
+            calculatefunction();
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to compile the function " << functionExpression << ": " << error.what() << endl;
+            glfwTerminate();
+            return -1;
+        }
+
+        if (cache)
+        {
+            try
+            {
+                SampleKey key = sampleKey();
+                saveBinaryDataset(cache->entryPath(key));
+                cache->store(key);
+            }
+            catch (const runtime_error& error)
+            {
+                cout << "Failed to save the samples in the sample cache: " << error.what() << endl;
+            }
+        }
+    }
+
+    if (cache)
+    {
+        cout << "Sample cache " << (cached ? "hit" : "miss") << " (" << cache->hits() << " hits, " << cache->misses()
+            << " misses, " << cache->evictions() << " evicted in all runs)" << endl;
+    }
+
+    if (runBenchmarks)
+    {
+        benchmarkBatchEvaluator(numberOfBenchmarkPoints);
+    }
 
     //Creates a VAO and binds it 
     unsigned int VAO;
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
-    //Creates two VBO for the position and color to the graph
+#if INTERLEAVED_VERTICES
+    const int vertexColorBuffers = 1;
+#else
+    const int vertexColorBuffers = 2;
+#endif
+    //Without the vertex colors one VBO is enough, and when the shader makes the vertices none is needed. The VAO is
+    //still bound when it draws, since the core profile does not draw without one
+    int bufferCount = gpuGeneration ? 0 : colorSource == ColorSource::VertexColors ? vertexColorBuffers : 1;
     unsigned int VBO[2];
-    glGenBuffers(2, VBO);
-
-    //Copies the x and y position to the graph to VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, verticesPositions.size() * sizeof(float), verticesPositions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    glGenBuffers(bufferCount, VBO);
 
-    //Copies the color data for the graph to the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(float), colors.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
+    if (gpuGeneration)
+    {
+        //Changing a or h only needs these two lines, not new samples and a new buffer
+        glUniform1f(glGetUniformLocation(shaderProgram, "a"), static_cast<float>(a));
+        glUniform1f(glGetUniformLocation(shaderProgram, "h"), static_cast<float>(h));
+    }
+    else if (colorSource != ColorSource::VertexColors)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        uploadShaderColoredVertices(shaderProgram);
+    }
+    else
+    {
+#if INTERLEAVED_VERTICES
+        //Creates one VBO with the position and color of each vertex next to each other
+        vector<PackedVertex> packedVertices = packVertices(verticesPositions, 2, colors);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+        glEnableVertexAttribArray(0);
+        //The color bytes are turned into 0..1 when the shader reads them. The shader only uses r, g, b
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, red));
+        glEnableVertexAttribArray(1);
+#else
+        //Creates two VBO for the position and color to the graph
+
+        //Copies the x and y position to the graph to VBO
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        glBufferData(GL_ARRAY_BUFFER, verticesPositions.size() * sizeof(float), verticesPositions.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        //Copies the color data for the graph to the VBO
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+        glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(float), colors.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+#endif
+    }
 
     //Closes the text file
     file.close();
 
+    if (writeBinaryDataset)
+    {
+        try
+        {
+            saveBinaryDataset("Data.bin");
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to save Data.bin: " << error.what() << endl;
+        }
+    }
+
     cout<< "The data points has been created and saved in the file 'Data.txt'"<<endl;
 
     /* Loop until the user closes the window */
@@ -202,7 +436,7 @@ int main(void)
         // Bind VAO
         glBindVertexArray(VAO);
 
-        glDrawArrays(GL_LINE_STRIP, 0, numberOfDataPoints);
+        glDrawArrays(GL_LINE_STRIP, 0, gpuGeneration ? numberOfDataPoints : verticesPositions.size() / 2);
 
         // Unbind VAO
         glBindVertexArray(0);
@@ -216,7 +450,7 @@ int main(void)
 
     // Cleans up and stops the program
     glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(2, VBO);
+    glDeleteBuffers(bufferCount, VBO);
     glDeleteProgram(shaderProgram);
 
     glfwTerminate();
@@ -240,32 +474,136 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     cout << "The window size is: " << width << " x " << height << endl;
 }
 
-// Function f(x)= x^2
-double function(double x)
-{
-    return pow(x, 2);
-}
-
 double differenceQuotient(double x)
 {
     //Calculates the Newtons quotient
     double h = 0.01;
-    return (function(x + h) - function(x)) / h;
+    return (::function(x + h) - ::function(x)) / h;
+}
+
+//Samples the function that is given as text in functionExpression. The compiled bytecode can not be evaluated with
+//dual numbers, so the Automatic mode uses Newtons quotient with the same h as differenceQuotient(x) instead
+void sampleExpression(const vector<double>& xValues, vector<double>& yValues, vector<double>& derivatives)
+{
+    //Throws runtime_error when the text is not a valid expression
+    Expression expression(functionExpression, { "x" });
+    const double* inputs[] = { xValues.data() };
+    expression.evaluate(inputs, yValues.data(), xValues.size());
+
+    if (derivativeMode == DerivativeMode::GridSamples)
+    {
+        gridDerivative(yValues.data(), 1, xValues.size(), h, derivatives.data());
+        return;
+    }
+
+    double quotientStep = 0.01;
+    vector<double> shifted(xValues.size());
+    for (size_t i = 0; i < xValues.size(); ++i)
+    {
+        shifted[i] = xValues[i] + quotientStep;
+    }
+    const double* shiftedInputs[] = { shifted.data() };
+    expression.evaluate(shiftedInputs, derivatives.data(), xValues.size());
+    for (size_t i = 0; i < xValues.size(); ++i)
+    {
+        derivatives[i] = (derivatives[i] - yValues[i]) / quotientStep;
+    }
+}
+
+//Samples the graph with the adaptive sampler and replaces the evenly spaced x values
+void sampleAdaptiveCurve(vector<double>& xValues, vector<double>& yValues, vector<double>& derivatives)
+{
+    CurveFunction curve;
+    unique_ptr<Expression> expression;
+    if (!functionExpression.empty())
+    {
+        expression.reset(new Expression(functionExpression, { "x" }));
+        curve = [&expression](double x)
+        {
+            double quotientStep = 0.01;
+            double shifted = x + quotientStep;
+            double y = expression->evaluate(&x);
+            return CurveSample{ x, y, (expression->evaluate(&shifted) - y) / quotientStep };
+        };
+    }
+    else
+    {
+        curve = [](double x)
+        {
+            Dual<double> y = ::function(Dual<double>::variable(x));
+            return CurveSample{ x, y.value, y.derivative() };
+        };
+    }
+
+    vector<CurveSample> samples = sampleAdaptive(curve, a, b, adaptiveTolerance, adaptiveBudget);
+    xValues.resize(samples.size());
+    yValues.resize(samples.size());
+    derivatives.resize(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        xValues[i] = samples[i].x;
+        yValues[i] = samples[i].y;
+        derivatives[i] = samples[i].derivative;
+    }
+
+    //The evenly spaced points are only counted up to a few times the budget, so the comparison stays cheap
+    size_t uniformCount = uniformSampleCount(curve, a, b, adaptiveTolerance, 4 * adaptiveBudget);
+    cout << "Adaptive sampling used " << samples.size() << " points, evenly spaced points would need ";
+    if (uniformCount == 0)
+    {
+        cout << "more than " << 4 * adaptiveBudget;
+    }
+    else
+    {
+        cout << uniformCount;
+    }
+    cout << " for the same error" << endl;
 }
 
 void calculatefunction()
 {
+    //All the x values are made first, so the function and the derivative can be evaluated for the whole array at once 
+    vector<double> xValues(numberOfDataPoints);
+    vector<double> yValues(numberOfDataPoints);
+    vector<double> derivatives(numberOfDataPoints);
     for (int i = 0; i < numberOfDataPoints; ++i)
-    {   
-        double x = a + i * h;
-        double y = function(x);
-        double derivative = differenceQuotient(x);
+    {
+        xValues[i] = a + i * h;
+    }
 
-        //The two first lines stores the coordinates for x anf y. 
-        //The third line stores the derivative for each vertex 
-        verticesPositions.push_back(x);
-        verticesPositions.push_back(y);
-        derivativeResults.push_back(derivative);
+    if (samplingMode == SamplingMode::Adaptive)
+    {
+        sampleAdaptiveCurve(xValues, yValues, derivatives);
+    }
+    else if (!functionExpression.empty())
+    {
+        sampleExpression(xValues, yValues, derivatives);
+    }
+    else if (derivativeMode == DerivativeMode::Automatic)
+    {
+        evaluateFunctionAndDerivativeBatch(xValues.data(), yValues.data(), derivatives.data(), numberOfDataPoints);
+    }
+    else if (derivativeMode == DerivativeMode::GridSamples)
+    {
+        evaluateFunctionBatch(xValues.data(), yValues.data(), numberOfDataPoints);
+        gridDerivative(yValues.data(), 1, numberOfDataPoints, h, derivatives.data());
+        if (reportDerivativeError)
+        {
+            reportGridDerivativeError(xValues.data(), derivatives.data(), numberOfDataPoints, 0.01);
+        }
+    }
+    else
+    {
+        evaluateFunctionBatch(xValues.data(), yValues.data(), numberOfDataPoints);
+        //Uses the same h as differenceQuotient(x)
+        differenceQuotientBatch(xValues.data(), derivatives.data(), numberOfDataPoints, 0.01);
+    }
+
+    for (size_t i = 0; i < xValues.size(); ++i)
+    {   
+        double x = xValues[i];
+        double y = yValues[i];
+        double derivative = derivatives[i];
 
         float red, green, blue;
         if (derivative > 0) {
@@ -281,12 +619,135 @@ void calculatefunction()
             blue = 0.0f;
         }
 
-        //These three lines are used to store the calculated values for r, g, b and put in the end of the vector
-        colors.push_back(red);
-        colors.push_back(green);
-        colors.push_back(blue);
+        saveVertex(static_cast<float>(x), static_cast<float>(y), static_cast<float>(derivative), red, green, blue);
+    }
+}
+
+//Stores one vertex for the vertex buffers and writes it to the text file
+void saveVertex(float x, float y, float derivative, float red, float green, float blue)
+{
+    //The two first lines stores the coordinates for x anf y. 
+    //The third line stores the derivative for each vertex 
+    verticesPositions.push_back(x);
+    verticesPositions.push_back(y);
+    derivativeResults.push_back(derivative);
+
+    //These three lines are used to store the calculated values for r, g, b and put in the end of the vector
+    colors.push_back(red);
+    colors.push_back(green);
+    colors.push_back(blue);
+
+    file << "x: " << x << " y: " << y << " derivative: " << derivative << " r: "
+        << red << " g: " << green << " b: " << blue << '\n';
+}
 
-        file << "x: " << x << " y: " << " derivative: " << derivative << y << " r: "
-            << red << " g: " << green << " b: " << blue << endl;
+//Copies the vertices to the bound VBO without the colors, for the color sources where the vertex shader picks red or
+//green itself, and tells the shader which one is used. The colors took 12 bytes for each vertex as floats
+void uploadShaderColoredVertices(unsigned int shaderProgram)
+{
+    size_t count = derivativeResults.size();
+    vector<float> vertices;
+    if (colorSource == ColorSource::DerivativeAttribute)
+    {
+        //x, y and the derivative for each vertex: 12 bytes
+        vertices.reserve(3 * count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            vertices.push_back(verticesPositions[2 * i]);
+            vertices.push_back(verticesPositions[2 * i + 1]);
+            vertices.push_back(derivativeResults[i]);
+        }
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(2);
     }
-}
\ No newline at end of file
+    else
+    {
+        //Only x and y for each vertex: 8 bytes. One extra vertex is put before the first and after the last, so every
+        //vertex has a vertex before and after it. The extra vertices continue the first and the last line of the graph
+        vertices.reserve(2 * (count + 2));
+        for (int c = 0; c < 2 && count > 0; ++c)
+        {
+            float first = verticesPositions[c];
+            float second = count > 1 ? verticesPositions[2 + c] : first;
+            vertices.push_back(2.0f * first - second);
+        }
+        vertices.insert(vertices.end(), verticesPositions.begin(), verticesPositions.begin() + 2 * count);
+        for (int c = 0; c < 2 && count > 0; ++c)
+        {
+            float last = verticesPositions[2 * (count - 1) + c];
+            float beforeLast = count > 1 ? verticesPositions[2 * (count - 2) + c] : last;
+            vertices.push_back(2.0f * last - beforeLast);
+        }
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        //The same buffer is read three times, one vertex apart: aPrevious from the start, aPos one vertex in and aNext
+        //two vertices in. Vertex i of the draw then gets the vertices i - 1, i and i + 1 of the graph
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(4);
+    }
+    glUniform1i(glGetUniformLocation(shaderProgram, "colorSource"), static_cast<int>(colorSource));
+}
+
+//Everything that changes the samples. Two runs with the same key make the same Data.txt
+SampleKey sampleKey()
+{
+    SampleKey key(functionExpression.empty() ? "Oppgave 1 function(x) = x^2" : functionExpression);
+    key.add("a", a).add("b", b).add("n", static_cast<long long>(n))
+        .add("numberOfDataPoints", static_cast<long long>(numberOfDataPoints))
+        .add("samplingMode", static_cast<long long>(samplingMode)).add("adaptiveTolerance", adaptiveTolerance)
+        .add("adaptiveBudget", static_cast<long long>(adaptiveBudget))
+        .add("derivativeMode", static_cast<long long>(derivativeMode))
+        .add("precision", "float").add("datasetVersion", static_cast<long long>(datasetVersion));
+    return key;
+}
+
+//Saves the graph in Data.bin. The positions are stored as x, y and the colors as r, g, b for each vertex, and are split
+//into one column for each
+void saveBinaryDataset(const string& path)
+{
+    size_t count = derivativeResults.size();
+    vector<vector<float>> columns(6, vector<float>(count));
+    for (size_t i = 0; i < count; ++i)
+    {
+        columns[0][i] = verticesPositions[2 * i];
+        columns[1][i] = verticesPositions[2 * i + 1];
+        columns[2][i] = derivativeResults[i];
+        columns[3][i] = colors[3 * i];
+        columns[4][i] = colors[3 * i + 1];
+        columns[5][i] = colors[3 * i + 2];
+    }
+
+    DatasetHeader header;
+    header.function = functionExpression.empty() ? DatasetFunction::Curve : DatasetFunction::Expression;
+    header.pointCount = count;
+    header.countX = static_cast<uint32_t>(count);
+    header.countY = 1;
+    header.domainMinimumX = a;
+    header.domainMaximumX = b;
+    header.columnNames = { "x", "y", "derivative", "r", "g", "b" };
+    writeDataset(path, header, { columns[0].data(), columns[1].data(), columns[2].data(),
+        columns[3].data(), columns[4].data(), columns[5].data() });
+}
+
+//Reads the graph from a file saved by saveBinaryDataset instead of calculating it, and writes it to Data.txt.
+//All the columns are read before anything is stored, so nothing has changed when it throws runtime_error
+void loadBinaryDataset(const string& path)
+{
+    const char* names[] = { "x", "y", "derivative", "r", "g", "b" };
+    vector<vector<float>> columns;
+    for (const char* name : names)
+    {
+        columns.push_back(readDatasetColumn(path, name));
+    }
+
+    for (size_t i = 0; i < columns[0].size(); ++i)
+    {
+        saveVertex(columns[0][i], columns[1][i], columns[2][i], columns[3][i], columns[4][i], columns[5][i]);
+    }
+}
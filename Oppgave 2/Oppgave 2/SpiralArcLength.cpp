@@ -0,0 +1,99 @@
+#include "SpiralArcLength.h"
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+SpiralArcLength::SpiralArcLength(double a, double b, double startT, double endT, size_t intervals)
+    : a(a), b(b), startT(startT), endT(endT), step((endT - startT) / intervals), cumulativeLength(intervals + 1)
+{
+    cumulativeLength[0] = 0.0;
+    for (size_t i = 0; i < intervals; ++i)
+    {
+        double t = startT + i * step;
+        cumulativeLength[i + 1] = cumulativeLength[i] + lengthInside(i, t + step);
+    }
+}
+
+double SpiralArcLength::speed(double t) const
+{
+    return sqrt(a * a * (1.0 + t * t) + b * b);
+}
+
+double SpiralArcLength::lengthInside(size_t index, double t) const
+{
+    //Simpson's rule. The speed is smooth, so one parabola for each small part of the table is very accurate
+    double t0 = startT + index * step;
+    return (t - t0) / 6.0 * (speed(t0) + 4.0 * speed(0.5 * (t0 + t)) + speed(t));
+}
+
+double SpiralArcLength::invertInside(size_t index, double s) const
+{
+    //Starts from a straight line between the two ends of the part, then Newton's method: the derivative of the
+    //length is the speed
+    double t0 = startT + index * step;
+    double s0 = cumulativeLength[index];
+    double s1 = cumulativeLength[index + 1];
+    double t = s1 > s0 ? t0 + (s - s0) / (s1 - s0) * step : t0;
+    for (int iteration = 0; iteration < 2; ++iteration)
+    {
+        t -= (s0 + lengthInside(index, t) - s) / speed(t);
+    }
+    return min(max(t, t0), t0 + step);
+}
+
+double SpiralArcLength::parameterAt(double s) const
+{
+    if (s <= 0.0)
+    {
+        return startT;
+    }
+    if (s >= length())
+    {
+        return endT;
+    }
+    size_t index = upper_bound(cumulativeLength.begin(), cumulativeLength.end(), s) - cumulativeLength.begin() - 1;
+    return invertInside(index, s);
+}
+
+void SpiralArcLength::generate(size_t count, float* positions) const
+{
+    size_t intervals = cumulativeLength.size() - 1;
+    size_t index = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        double t;
+        if (i == 0 || count == 1)
+        {
+            t = startT;
+        }
+        else if (i == count - 1)
+        {
+            t = endT;
+        }
+        else
+        {
+            double s = length() * i / (count - 1);
+            while (index + 1 < intervals && cumulativeLength[index + 1] <= s)
+            {
+                ++index;
+            }
+            t = invertInside(index, s);
+        }
+
+        positions[3 * i] = static_cast<float>(a * t * cos(t));
+        positions[3 * i + 1] = static_cast<float>(a * t * sin(t));
+        positions[3 * i + 2] = static_cast<float>(b * t);
+    }
+}
+
+size_t SpiralArcLength::pointCountForSegment(double maxSegmentLength) const
+{
+    return static_cast<size_t>(ceil(length() / maxSegmentLength)) + 1;
+}
+
+size_t SpiralArcLength::uniformPointCountForSegment(double maxSegmentLength) const
+{
+    //The speed is largest at the t furthest from 0
+    double fastest = speed(max(fabs(startT), fabs(endT)));
+    return static_cast<size_t>(ceil((endT - startT) * fastest / maxSegmentLength)) + 1;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+//The arc length of the spiral x = a t cos(t), y = a t sin(t), z = b t between startT and endT.
+//The speed |r'(t)| = sqrt(a^2 (1 + t^2) + b^2) grows with t, so points with equal steps in t lie close together in the
+//middle and far apart on the outer turns. With this table the points can instead be placed at equal distances along
+//the curve, so fewer points are needed for the same largest distance between two points
+class SpiralArcLength
+{
+public:
+    //Integrates the speed with Simpson's rule over 'intervals' equal parts of [startT, endT] and keeps the running sum
+    SpiralArcLength(double a, double b, double startT, double endT, size_t intervals = 4096);
+
+    //The length of the whole curve
+    double length() const { return cumulativeLength.back(); }
+
+    //The t where the arc length from startT is s. Finds the part of the table with a binary search and then the t
+    //inside it with Newton's method
+    double parameterAt(double s) const;
+
+    //Writes 'count' points (x, y, z after each other) at equal arc length from startT to endT. The lengths grow from
+    //point to point, so the table is walked once from start to end instead of searched for every point
+    void generate(size_t count, float* positions) const;
+
+    //The number of points needed so no segment is longer than maxSegmentLength, with equal arc length steps
+    size_t pointCountForSegment(double maxSegmentLength) const;
+
+    //The same with equal t steps. The longest segment is where the curve moves fastest
+    size_t uniformPointCountForSegment(double maxSegmentLength) const;
+
+private:
+    double speed(double t) const;
+    //The arc length from tableT[index] to t, for a t inside the part of the table that starts at index
+    double lengthInside(size_t index, double t) const;
+    double invertInside(size_t index, double s) const;
+
+    double a;
+    double b;
+    double startT;
+    double endT;
+    double step;
+    std::vector<double> cumulativeLength;
+};
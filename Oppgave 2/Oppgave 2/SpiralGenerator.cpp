@@ -0,0 +1,228 @@
+#include "SpiralGenerator.h"
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+#include <string>
+using namespace std;
+
+#if defined(__GNUC__)
+//The Double4 values are only passed between functions that are inlined into the AVX2 kernel, so the warning about
+//the ABI for AVX arguments does not matter here
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+#include "SimdDouble.h"
+
+namespace
+{
+    //Makes the points with 'Lanes' points side by side. Lanes = 1 is the plain version. The inner loops over the lanes
+    //have a fixed length, so the compiler can turn them into vector instructions
+    template<int Lanes>
+    void generateRotating(const SpiralParameters& spiral, size_t count, float* positions, size_t anchorInterval)
+    {
+        //The anchors must fall on a whole step of all the lanes
+        anchorInterval = max<size_t>(Lanes, anchorInterval / Lanes * Lanes);
+
+        //One step moves every lane Lanes points ahead
+        double rotationCos = cos(Lanes * spiral.stepT);
+        double rotationSin = sin(Lanes * spiral.stepT);
+
+        double c[Lanes], s[Lanes], t[Lanes];
+        float x[Lanes], y[Lanes], z[Lanes];
+
+        for (size_t first = 0; first < count; first += anchorInterval)
+        {
+            size_t n = min(anchorInterval, count - first);
+
+            //The anchor: cos and sin are calculated exactly for the first point of every lane
+            for (int k = 0; k < Lanes; ++k)
+            {
+                t[k] = spiral.startT + static_cast<double>(first + k) * spiral.stepT;
+                c[k] = cos(t[k]);
+                s[k] = sin(t[k]);
+            }
+
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                for (int k = 0; k < Lanes; ++k)
+                {
+                    x[k] = static_cast<float>(spiral.a * t[k] * c[k]);
+                    y[k] = static_cast<float>(spiral.a * t[k] * s[k]);
+                    z[k] = static_cast<float>(spiral.b * t[k]);
+                }
+
+                //Rotates (c, s) by the angle Lanes * stepT: (c + i s)(rotationCos + i rotationSin)
+                for (int k = 0; k < Lanes; ++k)
+                {
+                    double nextC = c[k] * rotationCos - s[k] * rotationSin;
+                    s[k] = s[k] * rotationCos + c[k] * rotationSin;
+                    c[k] = nextC;
+                    t[k] += Lanes * spiral.stepT;
+                }
+
+                //Only the last step of the spiral can have fewer than Lanes points left
+                float* out = positions + 3 * (first + i);
+                int valid = i + Lanes <= n ? Lanes : static_cast<int>(n - i);
+                if (valid == Lanes)
+                {
+                    for (int k = 0; k < Lanes; ++k)
+                    {
+                        out[3 * k] = x[k];
+                        out[3 * k + 1] = y[k];
+                        out[3 * k + 2] = z[k];
+                    }
+                }
+                else
+                {
+                    for (int k = 0; k < valid; ++k)
+                    {
+                        out[3 * k] = x[k];
+                        out[3 * k + 1] = y[k];
+                        out[3 * k + 2] = z[k];
+                    }
+                }
+            }
+        }
+    }
+}
+
+#ifdef SIMD_DOUBLE_X86
+    //generateRotating<4> with the 4 lanes in one AVX2 register. The steps are the same and in the same order, so the
+    //points are the same floats. Only the anchors and the stores to the float array are done one lane at a time
+    TARGET_AVX2 FLATTEN
+    void generateRotatingAvx2(const SpiralParameters& spiral, size_t count, float* positions, size_t anchorInterval)
+    {
+        const int Lanes = 4;
+        anchorInterval = max<size_t>(Lanes, anchorInterval / Lanes * Lanes);
+
+        double rotationCos = cos(Lanes * spiral.stepT);
+        double rotationSin = sin(Lanes * spiral.stepT);
+        double step = Lanes * spiral.stepT;
+
+        double anchorT[Lanes], anchorC[Lanes], anchorS[Lanes];
+        double x[Lanes], y[Lanes], z[Lanes];
+
+        for (size_t first = 0; first < count; first += anchorInterval)
+        {
+            size_t n = min(anchorInterval, count - first);
+
+            for (int k = 0; k < Lanes; ++k)
+            {
+                anchorT[k] = spiral.startT + static_cast<double>(first + k) * spiral.stepT;
+                anchorC[k] = cos(anchorT[k]);
+                anchorS[k] = sin(anchorT[k]);
+            }
+            Double4 t = loadVec<Double4>(anchorT);
+            Double4 c = loadVec<Double4>(anchorC);
+            Double4 s = loadVec<Double4>(anchorS);
+
+            for (size_t i = 0; i < n; i += Lanes)
+            {
+                storeVec(x, spiral.a * t * c);
+                storeVec(y, spiral.a * t * s);
+                storeVec(z, spiral.b * t);
+
+                Double4 nextC = c * rotationCos - s * rotationSin;
+                s = s * rotationCos + c * rotationSin;
+                c = nextC;
+                t = t + step;
+
+                float* out = positions + 3 * (first + i);
+                int valid = i + Lanes <= n ? Lanes : static_cast<int>(n - i);
+                for (int k = 0; k < valid; ++k)
+                {
+                    out[3 * k] = static_cast<float>(x[k]);
+                    out[3 * k + 1] = static_cast<float>(y[k]);
+                    out[3 * k + 2] = static_cast<float>(z[k]);
+                }
+            }
+        }
+    }
+#endif
+
+void generateSpiralDirect(const SpiralParameters& spiral, size_t count, float* positions)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        double t = spiral.startT + static_cast<double>(i) * spiral.stepT;
+        positions[3 * i] = static_cast<float>(spiral.a * t * cos(t));
+        positions[3 * i + 1] = static_cast<float>(spiral.a * t * sin(t));
+        positions[3 * i + 2] = static_cast<float>(spiral.b * t);
+    }
+}
+
+void generateSpiralRotating(const SpiralParameters& spiral, size_t count, float* positions, size_t anchorInterval)
+{
+    generateRotating<1>(spiral, count, positions, anchorInterval);
+}
+
+void generateSpiralRotatingSimd(const SpiralParameters& spiral, size_t count, float* positions, size_t anchorInterval)
+{
+    //The instruction set is only detected once, the first time it is needed
+    static const SimdLevel level = detectSimdLevel();
+    generateSpiralRotatingSimd(spiral, count, positions, level, anchorInterval);
+}
+
+void generateSpiralRotatingSimd(const SpiralParameters& spiral, size_t count, float* positions, SimdLevel level,
+    size_t anchorInterval)
+{
+#ifdef SIMD_DOUBLE_X86
+    if (level == SimdLevel::AVX2)
+    {
+        generateRotatingAvx2(spiral, count, positions, anchorInterval);
+        return;
+    }
+#endif
+    generateRotating<4>(spiral, count, positions, anchorInterval);
+}
+
+void benchmarkSpiralGenerators(size_t count)
+{
+    //Many turns of the spiral, so the rotations are tested over a long t range
+    SpiralParameters spiral = { 0.1, 0.1, 0.0, 1000.0 / count };
+    vector<float> reference(3 * count), positions(3 * count);
+
+    auto timeGenerator = [&](const string& name, void (*generate)(const SpiralParameters&, size_t, float*))
+    {
+        auto begin = chrono::steady_clock::now();
+        generate(spiral, count, positions.data());
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        float largestError = 0.0f;
+        for (size_t i = 0; i < positions.size(); ++i)
+        {
+            largestError = max(largestError, fabs(positions[i] - reference[i]));
+        }
+        cout << name << ": " << count / seconds << " points/second, largest difference from cos/sin: "
+            << largestError << endl;
+        return seconds;
+    };
+
+    generateSpiralDirect(spiral, count, reference.data());
+    timeGenerator("Spiral with cos/sin", generateSpiralDirect);
+    double oneLaneSeconds = timeGenerator("Spiral with rotations", [](const SpiralParameters& s, size_t n, float* p)
+    {
+        generateSpiralRotating(s, n, p);
+    });
+
+    //The 4 lanes as plain arrays, and in an AVX2 register when the processor has it
+    double arraySeconds = timeGenerator("Spiral with rotations, 4 lanes in arrays",
+        [](const SpiralParameters& s, size_t n, float* p)
+    {
+        generateSpiralRotatingSimd(s, n, p, SimdLevel::Scalar);
+    });
+    cout << "4 lanes in arrays: " << oneLaneSeconds / arraySeconds << "x the points/second of one lane" << endl;
+
+    if (detectSimdLevel() == SimdLevel::AVX2)
+    {
+        double registerSeconds = timeGenerator("Spiral with rotations, 4 lanes in an AVX2 register",
+            [](const SpiralParameters& s, size_t n, float* p)
+        {
+            generateSpiralRotatingSimd(s, n, p, SimdLevel::AVX2);
+        });
+        cout << "4 lanes in an AVX2 register: " << oneLaneSeconds / registerSeconds << "x the points/second of one lane"
+            << endl;
+    }
+}
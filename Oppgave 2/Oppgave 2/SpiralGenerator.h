@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include "SimdLevel.h"
+
+//The spiral x = a t cos(t), y = a t sin(t), z = b t sampled at t = startT + i * stepT for i = 0..count-1
+struct SpiralParameters
+{
+    double a;
+    double b;
+    double startT;
+    double stepT;
+};
+
+//The points are written as x, y, z after each other, so 'positions' must have room for 3 * count floats.
+
+//Calls cos and sin for every point. Used as the reference for the other two
+void generateSpiralDirect(const SpiralParameters& spiral, size_t count, float* positions);
+
+//Since t grows by the same step every time, the next (cos t, sin t) is the current one rotated by the angle stepT.
+//The rotation is one complex multiplication, so there are no cos and sin calls in the loop. Rounding errors add up a
+//little for each rotation, so every 'anchorInterval' points cos and sin are calculated exactly again
+void generateSpiralRotating(const SpiralParameters& spiral, size_t count, float* positions, size_t anchorInterval = 256);
+
+//The same as generateSpiralRotating, but 4 points are made for each step. Each of the 4 lanes is rotated by 4 * stepT.
+//With AVX2 the 4 lanes are one Double4 register (see SimdDouble.h), otherwise they are plain arrays that the compiler
+//can turn into SSE instructions. Both do the same operations in the same order, so they give the same points.
+//The first version uses the best instruction set found by detectSimdLevel()
+void generateSpiralRotatingSimd(const SpiralParameters& spiral, size_t count, float* positions,
+    size_t anchorInterval = 256);
+void generateSpiralRotatingSimd(const SpiralParameters& spiral, size_t count, float* positions, SimdLevel level,
+    size_t anchorInterval = 256);
+
+//Makes 'count' points with each of the generators and prints the points per second, how many times faster the 4 lanes
+//are than one lane, and the largest difference from the direct version
+void benchmarkSpiralGenerators(size_t count);
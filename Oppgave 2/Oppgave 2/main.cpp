@@ -4,13 +4,75 @@
 #include <vector>
 #include <cmath>
 #include <fstream>
+#include <string>
+#include <stdexcept>
+#include "Expression.h"
+#include "SpiralGenerator.h"
+#include "SpiralArcLength.h"
+#include "TextWriter.h"
+#include "Dataset.h"
+#include "SampleCache.h"
+#include "MeshExport.h"
+#include "PackedVertex.h"
+#include "QuantizedVertex.h"
+#include <memory>
+#include <cstddef>
 
 using namespace std;
 
+//1 puts the position and the color of each vertex next to each other in one buffer, with the color as bytes
+//(see PackedVertex.h). 0 uses one float buffer for the positions and one for the colors, to compare with
+#define INTERLEAVED_VERTICES 1
+
+//How the positions are stored in the interleaved vertex buffer (see QuantizedVertex.h). HalfFloat and Snorm16 take 12
+//bytes for each vertex instead of 16, and print how far the positions the shader gets are from the float positions
+PositionEncoding positionEncoding = PositionEncoding::Float;
+
+//Set to true to let the vertex shader make the points of the spiral from gl_VertexID, a, b and the step in t, so no
+//vertex buffer is uploaded at all. Only used for the formulas in Spiral() with equal steps in t, since the shader has
+//its own copy of them. Data.txt is still written from the samples on the CPU
+bool generateOnGpu = false;
+
 //Parameters that are used to define the shape of the spiral 
 float a = 0.1f; //Affetcs the distance between the circles in the spiral 
 float b = 0.1f; //Affects the height of the circles in the spiral 
 
+//Number of data points to be generated with equal steps in t
+int spiralPointCount = 50;
+
+//The spiral can be given as text with the variable t and the parameters a and b, for example "a*t*cos(t)".
+//The texts are compiled when the program starts. When they are empty the formulas in Spiral() are used
+string spiralExpressionX = "";
+string spiralExpressionY = "";
+string spiralExpressionZ = "";
+
+//How the points are placed along the spiral. UniformT uses equal steps in t, ArcLength uses equal distances along the
+//curve, with as many points as needed so no segment is longer than maximumSegmentLength. ArcLength is only used for the
+//formulas in Spiral(), not for a spiral given as text
+enum class SpiralSampling { UniformT, ArcLength };
+SpiralSampling spiralSampling = SpiralSampling::UniformT;
+double maximumSegmentLength = 0.02;
+
+//Set to true to also save the points in the binary file Data.bin, with one float column for each of x, y, z, r, g, b
+//(see Dataset.h)
+bool writeBinaryDataset = false;
+
+//Set to a file name, for example "Data.ply" or "Data.obj", to also save the spiral as a line through the points
+//(see MeshExport.h)
+string meshExport = "";
+
+//The t range of the spiral. Set by Spiral() and saved in Data.bin
+double spiralStartT = 0.0;
+double spiralEndT = 0.0;
+
+//Set to true to keep the samples in the folder SampleCache (see SampleCache.h). When the spiral and all the settings
+//above are the same as in an earlier run, the samples are read from there instead of being calculated again.
+//Change the name in sampleKey() when the formulas in Spiral() are changed
+bool useSampleCache = false;
+
+//Set to true to measure how fast the spiral generators are
+bool runBenchmarks = false;
+
 //Stores the coordinates x, y, z.
 vector<float> verticesPositions;
 //Stores the color coordinates for every single vertex 
@@ -20,20 +82,44 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 void processInput(GLFWwindow* window);
 
-ofstream file("Data.txt");
+//TextWriter keeps the lines in a large buffer, so the file is not flushed for every line
+TextWriter file("Data.txt");
 
 void Spiral();
+void saveVertex(float x, float y, float z, float red, float green, float blue);
+SampleKey sampleKey();
+void saveBinaryDataset(const string& path);
+void loadBinaryDataset(const string& path);
 
 const char* vertexShaderSource = 
     "#version 330 core\n"
     "layout (location = 0) in vec3 aPos;\n"
     "layout (location = 1) in vec3 aColor;\n"
+    //Turns 16-bit positions back into the coordinates of the spiral. Float positions use the values they start with
+    "uniform vec3 positionCenter = vec3(0.0);\n"
+    "uniform vec3 positionScale = vec3(1.0);\n"
     "out vec3 color;\n"
     "void main(){\n"
-     "   gl_Position = vec4(aPos, 1.0);\n"
+     "   gl_Position = vec4(positionCenter + positionScale * aPos, 1.0);\n"
      "   color = aColor;\n"
     "}\0";
 
+//The vertex shader used when generateOnGpu is set. It has no inputs: vertex i of the draw is the point at t = i * stepT,
+//with the same formulas and colors as Spiral()
+const char* generatingVertexShaderSource =
+    "#version 330 core\n"
+    "uniform float a;\n"
+    "uniform float b;\n"
+    "uniform float stepT;\n"
+    "uniform int pointCount;\n"
+    "out vec3 color;\n"
+    "void main(){\n"
+     "   float t = float(gl_VertexID) * stepT;\n"
+     "   gl_Position = vec4(a * t * cos(t), a * t * sin(t), b * t, 1.0);\n"
+     "   float red = float(gl_VertexID) / float(pointCount);\n"
+     "   color = vec3(red, 0.5 - red, 1.0);\n"
+    "}\0";
+
 const char* fragmentShaderSource = 
     "#version 330 core\n"
     "in vec3 color;\n"
@@ -72,10 +158,19 @@ int main() {
     glViewport(0, 0, 800, 600);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    //The shader only knows the formulas in Spiral() with equal steps in t
+    bool useExpressions = !spiralExpressionX.empty() || !spiralExpressionY.empty() || !spiralExpressionZ.empty();
+    bool gpuGeneration = generateOnGpu && !useExpressions && spiralSampling == SpiralSampling::UniformT;
+    if (generateOnGpu && !gpuGeneration)
+    {
+        cout << "Only the spiral in Spiral() with equal steps in t can be made on the GPU, so the vertices are uploaded"
+            << endl;
+    }
+
     unsigned int vertexShader, fragmentShader, shaderProgram; 
 
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+    glShaderSource(vertexShader, 1, gpuGeneration ? &generatingVertexShaderSource : &vertexShaderSource, nullptr);
     glCompileShader(vertexShader);
     int success;
     char infoLog[512];
@@ -109,30 +204,188 @@ int main() {
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    Spiral();
+    //Looks for the same samples from an earlier run first
+    unique_ptr<SampleCache> cache;
+    bool cached = false;
+    if (useSampleCache)
+    {
+        try
+        {
+            cache.reset(new SampleCache());
+            string path;
+            if (cache->find(sampleKey(), path))
+            {
+                loadBinaryDataset(path);
+                cached = true;
+            }
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to use the sample cache: " << error.what() << endl;
+        }
+    }
+
+    if (!cached)
+    {
+        try
+        {
+            Spiral();
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to compile the spiral: " << error.what() << endl;
+            glfwTerminate();
+            return -1;
+        }
+
+        if (cache)
+        {
+            try
+            {
+                SampleKey key = sampleKey();
+                saveBinaryDataset(cache->entryPath(key));
+                cache->store(key);
+            }
+            catch (const runtime_error& error)
+            {
+                cout << "Failed to save the samples in the sample cache: " << error.what() << endl;
+            }
+        }
+    }
+
+    if (cache)
+    {
+        cout << "Sample cache " << (cached ? "hit" : "miss") << " (" << cache->hits() << " hits, " << cache->misses()
+            << " misses, " << cache->evictions() << " evicted in all runs)" << endl;
+    }
 
     //Creates a VAO and binds it 
     unsigned int VAO;
     glGenVertexArrays(1, &VAO);
     glBindVertexArray(VAO);
 
-    //Creates two VBO for the position and color to the graph
+#if INTERLEAVED_VERTICES
+    const int vertexBuffers = 1;
+#else
+    const int vertexBuffers = 2;
+#endif
+    //No VBO is needed when the shader makes the vertices. The VAO is still bound when it draws, since the core profile
+    //does not draw without one
+    int bufferCount = gpuGeneration ? 0 : vertexBuffers;
     unsigned int VBO[2];
-    glGenBuffers(2, VBO);
+    glGenBuffers(bufferCount, VBO);
+
+    if (gpuGeneration)
+    {
+        //Changing a, b or the number of points only needs these lines, not new samples and a new buffer
+        glUniform1f(glGetUniformLocation(shaderProgram, "a"), a);
+        glUniform1f(glGetUniformLocation(shaderProgram, "b"), b);
+        glUniform1f(glGetUniformLocation(shaderProgram, "stepT"), 10.0f / spiralPointCount);
+        glUniform1i(glGetUniformLocation(shaderProgram, "pointCount"), spiralPointCount);
+    }
+    else
+    {
+#if INTERLEAVED_VERTICES
+        //Creates one VBO with the position and color of each vertex next to each other
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        if (positionEncoding == PositionEncoding::Float)
+        {
+            vector<PackedVertex> packedVertices = packVertices(verticesPositions, 3, spiralColors);
+            glBufferData(GL_ARRAY_BUFFER, packedVertices.size() * sizeof(PackedVertex), packedVertices.data(),
+                GL_STATIC_DRAW);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, x));
+            glEnableVertexAttribArray(0);
+            //The color bytes are turned into 0..1 when the shader reads them. The shader only uses r, g, b
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, red));
+            glEnableVertexAttribArray(1);
+        }
+        else
+        {
+            PositionScale scale;
+            vector<QuantizedVertex> quantizedVertices = packQuantizedVertices(verticesPositions, 3, spiralColors,
+                positionEncoding, scale);
+            glBufferData(GL_ARRAY_BUFFER, quantizedVertices.size() * sizeof(QuantizedVertex), quantizedVertices.data(),
+                GL_STATIC_DRAW);
+            //Snorm16 is read as whole numbers and scaled in the shader, which gives the same positions on every driver
+            bool half = positionEncoding == PositionEncoding::HalfFloat;
+            glVertexAttribPointer(0, 3, half ? GL_HALF_FLOAT : GL_SHORT, GL_FALSE, sizeof(QuantizedVertex),
+                (void*)offsetof(QuantizedVertex, x));
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuantizedVertex),
+                (void*)offsetof(QuantizedVertex, red));
+            glEnableVertexAttribArray(1);
+            glUniform3fv(glGetUniformLocation(shaderProgram, "positionCenter"), 1, scale.center);
+            glUniform3fv(glGetUniformLocation(shaderProgram, "positionScale"), 1, scale.scale);
+
+            QuantizationError error = quantizationError(quantizedVertices, verticesPositions, 3, positionEncoding, scale);
+            cout << (half ? "Half float" : "Snorm16") << " positions: " << sizeof(QuantizedVertex)
+                << " bytes for each vertex instead of " << sizeof(PackedVertex) << ", largest error " << error.largest
+                << ", average error " << error.average << endl;
+        }
+#else
+        //Creates two VBO for the position and color to the graph
+        //Copies the x and y position to the graph to VBO
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
+        glBufferData(GL_ARRAY_BUFFER, verticesPositions.size() * sizeof(float), verticesPositions.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        //Copies the color data for the graph to the VBO
+        glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
+        glBufferData(GL_ARRAY_BUFFER, spiralColors.size() * sizeof(float), spiralColors.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+#endif
+    }
+
+    try
+    {
+        file.close();
+    }
+    catch (const runtime_error& error)
+    {
+        cout << "Failed to save Data.txt: " << error.what() << endl;
+    }
 
-    //Copies the x and y position to the graph to VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[0]);
-    glBufferData(GL_ARRAY_BUFFER, verticesPositions.size() * sizeof(float), verticesPositions.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    if (writeBinaryDataset)
+    {
+        try
+        {
+            saveBinaryDataset("Data.bin");
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to save Data.bin: " << error.what() << endl;
+        }
+    }
 
-    //Copies the color data for the graph to the VBO
-    glBindBuffer(GL_ARRAY_BUFFER, VBO[1]);
-    glBufferData(GL_ARRAY_BUFFER, spiralColors.size() * sizeof(float), spiralColors.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
+    if (!meshExport.empty())
+    {
+        //The positions and colors are read straight from the arrays of the vertex buffers
+        MeshVertices vertices;
+        vertices.x = verticesPositions.data();
+        vertices.y = verticesPositions.data() + 1;
+        vertices.z = verticesPositions.data() + 2;
+        vertices.red = spiralColors.data();
+        vertices.green = spiralColors.data() + 1;
+        vertices.blue = spiralColors.data() + 2;
+        vertices.stride = 3;
+        vertices.count = verticesPositions.size() / 3;
+        try
+        {
+            writePolylineMesh(meshExport, vertices);
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to save " << meshExport << ": " << error.what() << endl;
+        }
+    }
 
-    file.close();
+    if (runBenchmarks)
+    {
+        //Ten million points, about what an animated spiral with many turns needs in one frame
+        benchmarkSpiralGenerators(10000000);
+    }
 
     cout << "The data points has been created and saved in the file 'Data.txt'" << endl;
 
@@ -143,14 +396,14 @@ int main() {
         glClear(GL_COLOR_BUFFER_BIT);
         glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
-        glDrawArrays(GL_LINE_STRIP, 0, verticesPositions.size()/3);
+        glDrawArrays(GL_LINE_STRIP, 0, gpuGeneration ? spiralPointCount : verticesPositions.size()/3);
      
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
     glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(2, VBO);
+    glDeleteBuffers(bufferCount, VBO);
     glDeleteProgram(shaderProgram);
 
     glfwTerminate();
@@ -179,24 +432,70 @@ void Spiral()
 {
     //Number of data points to be generated. 
     //The loop will iterate 50 times for genereating 50 data points 
-     int numberOfDataPoints = 50;
-    for (int i = 0; i < numberOfDataPoints; ++i) 
+     int numberOfDataPoints = spiralPointCount;
+    //t goes from 0 in steps of 10 / numberOfDataPoints
+    spiralEndT = 10.0 * (numberOfDataPoints - 1) / numberOfDataPoints;
+
+    //When the spiral is given as text, all the points are evaluated at once by the compiled expressions
+    bool useExpressions = !spiralExpressionX.empty() || !spiralExpressionY.empty() || !spiralExpressionZ.empty();
+    vector<double> tValues, xValues, yValues, zValues;
+    vector<float> generatedPositions;
+    if (useExpressions)
     {
-        //t is used to control the position along the spiral 
-        //Converts the loop variable 'i' from int to float with casting operation 
-        float t = static_cast<float>(i) / numberOfDataPoints * 10.0f;
-
-        //cos(t) and sin(t) are trigonometric functions. They create circular motions along the 
-        //x- axis and y- axis 
-        float x = a * t * cos(t);
-        float y = a * t * sin(t);
-        //Decides the height of the circle in the spiral and increase along the x-axis
-        float z = b * t;
+        //t is used to control the position along the spiral
+        for (int i = 0; i < numberOfDataPoints; ++i)
+        {
+            tValues.push_back(static_cast<float>(i) / numberOfDataPoints * 10.0f);
+        }
+        vector<pair<string, double>> parameters = { { "a", a }, { "b", b } };
+        const double* inputs[] = { tValues.data() };
+        //An empty text uses the same formula as the code below
+        Expression expressionX(spiralExpressionX.empty() ? "a*t*cos(t)" : spiralExpressionX, { "t" }, parameters);
+        Expression expressionY(spiralExpressionY.empty() ? "a*t*sin(t)" : spiralExpressionY, { "t" }, parameters);
+        Expression expressionZ(spiralExpressionZ.empty() ? "b*t" : spiralExpressionZ, { "t" }, parameters);
+        xValues.resize(numberOfDataPoints);
+        yValues.resize(numberOfDataPoints);
+        zValues.resize(numberOfDataPoints);
+        expressionX.evaluate(inputs, xValues.data(), numberOfDataPoints);
+        expressionY.evaluate(inputs, yValues.data(), numberOfDataPoints);
+        expressionZ.evaluate(inputs, zValues.data(), numberOfDataPoints);
+    }
+    else if (spiralSampling == SpiralSampling::ArcLength)
+    {
+        //The same t range as the equal steps below
+        SpiralArcLength curve(a, b, spiralStartT, spiralEndT);
+        size_t uniformCount = curve.uniformPointCountForSegment(maximumSegmentLength);
+        numberOfDataPoints = static_cast<int>(curve.pointCountForSegment(maximumSegmentLength));
+        generatedPositions.resize(3 * numberOfDataPoints);
+        curve.generate(numberOfDataPoints, generatedPositions.data());
+        cout << "Equal arc length uses " << numberOfDataPoints << " points for segments of at most "
+            << maximumSegmentLength << ", equal t steps would need " << uniformCount << endl;
+    }
+    else
+    {
+        //t goes from 0 to 10 in equal steps, so cos(t) and sin(t) are found by rotating instead of calling cos and sin
+        SpiralParameters spiral = { a, b, 0.0, 10.0 / numberOfDataPoints };
+        generatedPositions.resize(3 * numberOfDataPoints);
+        generateSpiralRotatingSimd(spiral, numberOfDataPoints, generatedPositions.data());
+    }
 
-        //These three lines are used to store the calculated values of x,y and z in the end of the vector
-        verticesPositions.push_back(x);
-        verticesPositions.push_back(y);
-        verticesPositions.push_back(z);
+    for (int i = 0; i < numberOfDataPoints; ++i) 
+    {
+        float x, y, z;
+        if (useExpressions)
+        {
+            x = static_cast<float>(xValues[i]);
+            y = static_cast<float>(yValues[i]);
+            z = static_cast<float>(zValues[i]);
+        }
+        else
+        {
+            //x = a t cos(t) and y = a t sin(t) create circular motions along the x- axis and y- axis,
+            //z = b t decides the height of the circle in the spiral
+            x = generatedPositions[3 * i];
+            y = generatedPositions[3 * i + 1];
+            z = generatedPositions[3 * i + 2];
+        }
 
         //The color value to red varies from 0 to 1 were the loop variable 1 is 
         //divided by numberOfDataPoints. 
@@ -205,14 +504,83 @@ void Spiral()
         float green = 0.5f - red;
         float blue = 1.0f;
 
-        //These three lines are used to store the calculated values for r, g, b and put in the end of the vector
-        spiralColors.push_back(red);
-        spiralColors.push_back(green);
-        spiralColors.push_back(blue);
-        
-        file << "x: "<< x << " y: "<< y <<" z: " << z << " r: "
-        << red<< " g: "<< green << " b: " << blue <<endl;
+        saveVertex(x, y, z, red, green, blue);
     }
 }
 
+//Stores one vertex for the vertex buffers and writes it to the text file
+void saveVertex(float x, float y, float z, float red, float green, float blue)
+{
+    //These three lines are used to store the calculated values of x,y and z in the end of the vector
+    verticesPositions.push_back(x);
+    verticesPositions.push_back(y);
+    verticesPositions.push_back(z);
+
+    //These three lines are used to store the calculated values for r, g, b and put in the end of the vector
+    spiralColors.push_back(red);
+    spiralColors.push_back(green);
+    spiralColors.push_back(blue);
+
+    file << "x: "<< x << " y: "<< y <<" z: " << z << " r: "
+    << red<< " g: "<< green << " b: " << blue <<'\n';
+}
 
+//Everything that changes the samples. Two runs with the same key make the same Data.txt
+SampleKey sampleKey()
+{
+    bool useExpressions = !spiralExpressionX.empty() || !spiralExpressionY.empty() || !spiralExpressionZ.empty();
+    SampleKey key(useExpressions ? spiralExpressionX + ", " + spiralExpressionY + ", " + spiralExpressionZ :
+        "Oppgave 2 spiral (a t cos(t), a t sin(t), b t)");
+    key.add("a", a).add("b", b).add("spiralPointCount", static_cast<long long>(spiralPointCount))
+        .add("spiralSampling", static_cast<long long>(spiralSampling)).add("maximumSegmentLength", maximumSegmentLength)
+        .add("precision", "float").add("datasetVersion", static_cast<long long>(datasetVersion));
+    return key;
+}
+
+//Saves the spiral in Data.bin. The positions and colors are stored as x, y, z for each vertex, and are split into one
+//column for each coordinate
+void saveBinaryDataset(const string& path)
+{
+    size_t count = verticesPositions.size() / 3;
+    vector<vector<float>> columns(6, vector<float>(count));
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            columns[c][i] = verticesPositions[3 * i + c];
+            columns[3 + c][i] = spiralColors[3 * i + c];
+        }
+    }
+
+    DatasetHeader header;
+    bool useExpressions = !spiralExpressionX.empty() || !spiralExpressionY.empty() || !spiralExpressionZ.empty();
+    header.function = useExpressions ? DatasetFunction::Expression : DatasetFunction::Spiral;
+    header.pointCount = count;
+    header.countX = static_cast<uint32_t>(count);
+    header.countY = 1;
+    header.domainMinimumX = spiralStartT;
+    header.domainMaximumX = spiralEndT;
+    header.columnNames = { "x", "y", "z", "r", "g", "b" };
+    writeDataset(path, header, { columns[0].data(), columns[1].data(), columns[2].data(),
+        columns[3].data(), columns[4].data(), columns[5].data() });
+}
+
+//Reads the spiral from a file saved by saveBinaryDataset instead of calculating it, and writes it to Data.txt.
+//All the columns are read before anything is stored, so nothing has changed when it throws runtime_error
+void loadBinaryDataset(const string& path)
+{
+    DatasetHeader header = readDatasetHeader(path);
+    const char* names[] = { "x", "y", "z", "r", "g", "b" };
+    vector<vector<float>> columns;
+    for (const char* name : names)
+    {
+        columns.push_back(readDatasetColumn(path, name));
+    }
+
+    spiralStartT = header.domainMinimumX;
+    spiralEndT = header.domainMaximumX;
+    for (size_t i = 0; i < columns[0].size(); ++i)
+    {
+        saveVertex(columns[0][i], columns[1][i], columns[2][i], columns[3][i], columns[4][i], columns[5][i]);
+    }
+}
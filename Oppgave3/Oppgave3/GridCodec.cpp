@@ -0,0 +1,233 @@
+#include "GridCodec.h"
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+namespace
+{
+    const char magic[4] = { 'S', 'G', 'R', 'D' };
+    const size_t headerSize = 64;
+
+    //The largest number of steps a value can be. Then the difference of two values still fits in an int64_t
+    const double largestStepCount = 4.0e18;
+
+    template<typename T>
+    void put(char* bytes, size_t offset, T value)
+    {
+        memcpy(bytes + offset, &value, sizeof(T));
+    }
+
+    template<typename T>
+    T get(const char* bytes, size_t offset)
+    {
+        T value;
+        memcpy(&value, bytes + offset, sizeof(T));
+        return value;
+    }
+
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    void putVarint(vector<uint8_t>& bytes, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    //Reads one varint and moves p past it. Returns false when the bytes end inside it or it is longer than 64 bits
+    bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (byte < 0x80)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+void writeGridCodec(const string& path, const GridDomain& domain, const double* z, double tolerance, int chunkRows)
+{
+    if (!(tolerance > 0.0))
+    {
+        throw runtime_error("The tolerance of the grid codec must be larger than 0");
+    }
+    chunkRows = max(chunkRows, 1);
+
+    ofstream file(path, ios::binary);
+    if (!file)
+    {
+        throw runtime_error("Could not open " + path + " for writing");
+    }
+
+    char header[headerSize] = {};
+    memcpy(header, magic, sizeof(magic));
+    put(header, 4, gridCodecVersion);
+    put(header, 8, static_cast<int32_t>(domain.countX));
+    put(header, 12, static_cast<int32_t>(domain.countY));
+    put(header, 16, domain.startX);
+    put(header, 24, domain.startY);
+    put(header, 32, domain.stepX);
+    put(header, 40, domain.stepY);
+    put(header, 48, tolerance);
+    put(header, 56, static_cast<uint32_t>(chunkRows));
+    file.write(header, headerSize);
+
+    //Rounding to the nearest step of 2 * tolerance moves a value at most one tolerance
+    double step = 2.0 * tolerance;
+    vector<uint8_t> bytes;
+    for (int firstRow = 0; firstRow < domain.countX; firstRow += chunkRows)
+    {
+        int rowCount = min(chunkRows, domain.countX - firstRow);
+        bytes.clear();
+        int64_t rowStart = 0;
+        for (int i = firstRow; i < firstRow + rowCount; ++i)
+        {
+            int64_t previous = rowStart;
+            for (int j = 0; j < domain.countY; ++j)
+            {
+                double steps = round(z[static_cast<size_t>(i) * domain.countY + j] / step);
+                if (!(fabs(steps) <= largestStepCount))
+                {
+                    throw runtime_error("The value at row " + to_string(i) + ", column " + to_string(j) +
+                        " can not be stored with a tolerance of " + to_string(tolerance));
+                }
+                int64_t value = static_cast<int64_t>(steps);
+                putVarint(bytes, zigzag(value - previous));
+                if (j == 0)
+                {
+                    rowStart = value;
+                }
+                previous = value;
+            }
+        }
+
+        uint32_t chunkHeader[2] = { static_cast<uint32_t>(rowCount), static_cast<uint32_t>(bytes.size()) };
+        file.write(reinterpret_cast<const char*>(chunkHeader), sizeof(chunkHeader));
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    }
+    if (!file)
+    {
+        throw runtime_error("Could not write " + path);
+    }
+}
+
+GridDecoder::GridDecoder(const string& path)
+    : path(path), file(path, ios::binary)
+{
+    if (!file)
+    {
+        throw runtime_error("Could not open " + path);
+    }
+
+    //The size is used to check the chunk headers before their bytes are allocated
+    file.seekg(0, ios::end);
+    fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    char header[headerSize];
+    file.read(header, headerSize);
+    if (!file || memcmp(header, magic, sizeof(magic)) != 0)
+    {
+        throw runtime_error(path + " is not a grid file");
+    }
+    uint32_t version = get<uint32_t>(header, 4);
+    if (version != gridCodecVersion)
+    {
+        throw runtime_error(path + " has grid version " + to_string(version) + ", only version " +
+            to_string(gridCodecVersion) + " can be read");
+    }
+    gridDomain.countX = get<int32_t>(header, 8);
+    gridDomain.countY = get<int32_t>(header, 12);
+    gridDomain.startX = get<double>(header, 16);
+    gridDomain.startY = get<double>(header, 24);
+    gridDomain.stepX = get<double>(header, 32);
+    gridDomain.stepY = get<double>(header, 40);
+    gridTolerance = get<double>(header, 48);
+    if (gridDomain.countX < 0 || gridDomain.countY < 0 || !(gridTolerance > 0.0))
+    {
+        throw runtime_error(path + " has a damaged header");
+    }
+}
+
+bool GridDecoder::readChunk(vector<double>& z, int& firstRow, int& rowCount)
+{
+    if (nextRow >= gridDomain.countX)
+    {
+        return false;
+    }
+
+    uint32_t chunkHeader[2];
+    file.read(reinterpret_cast<char*>(chunkHeader), sizeof(chunkHeader));
+    if (!file || chunkHeader[0] == 0 || chunkHeader[0] > static_cast<uint32_t>(gridDomain.countX - nextRow))
+    {
+        throw runtime_error(path + " is damaged at row " + to_string(nextRow));
+    }
+    firstRow = nextRow;
+    rowCount = static_cast<int>(chunkHeader[0]);
+
+    //Every value takes at least one byte, so a chunk can not have more values than bytes, and the bytes must be in the
+    //file. The numbers come from the file, so they are checked before they are used for the sizes of the arrays
+    uint64_t remainingBytes = fileSize - static_cast<uint64_t>(file.tellg());
+    uint64_t valueCount = static_cast<uint64_t>(rowCount) * gridDomain.countY;
+    if (chunkHeader[1] > remainingBytes || valueCount > chunkHeader[1])
+    {
+        throw runtime_error(path + " is damaged at row " + to_string(firstRow) + ": the chunk has " +
+            to_string(chunkHeader[1]) + " bytes for " + to_string(valueCount) + " values, and " +
+            to_string(remainingBytes) + " bytes are left in the file");
+    }
+    bytes.resize(chunkHeader[1]);
+    file.read(reinterpret_cast<char*>(bytes.data()), static_cast<streamsize>(bytes.size()));
+    if (!file)
+    {
+        throw runtime_error(path + " ends inside the chunk at row " + to_string(firstRow));
+    }
+
+    double step = 2.0 * gridTolerance;
+    z.resize(static_cast<size_t>(valueCount));
+    const uint8_t* p = bytes.data();
+    const uint8_t* end = p + bytes.size();
+    int64_t rowStart = 0;
+    size_t index = 0;
+    for (int i = 0; i < rowCount; ++i)
+    {
+        int64_t previous = rowStart;
+        for (int j = 0; j < gridDomain.countY; ++j)
+        {
+            uint64_t difference;
+            if (!getVarint(p, end, difference))
+            {
+                throw runtime_error(path + " is damaged at row " + to_string(firstRow + i));
+            }
+            //The sum is done without sign, so a damaged file can not overflow it
+            int64_t value = static_cast<int64_t>(static_cast<uint64_t>(previous) +
+                static_cast<uint64_t>(unzigzag(difference)));
+            z[index++] = value * step;
+            if (j == 0)
+            {
+                rowStart = value;
+            }
+            previous = value;
+        }
+    }
+    nextRow += rowCount;
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "GridSampler.h"
+
+//A small file format for sampled grids (.grid), with no libraries needed to read it.
+//The surface is smooth, so neighbouring z values are almost the same and their differences are small numbers:
+//  1. z is rounded to a whole number of steps of 2 * tolerance, so the error is never more than the tolerance
+//  2. each value is stored as the difference to the value before it in the row (the first value of a row as the
+//     difference to the first value of the row before)
+//  3. the difference is zigzag coded (0, -1, 1, -2, 2 become 0, 1, 2, 3, 4), so small negative numbers are small too
+//  4. and then written as a varint: 7 bits in each byte, and the top bit tells that another byte follows
+//
+//The rows are stored in chunks that start over from 0, so a reader can decode one chunk at a time without having
+//the whole grid in memory.
+//
+//Layout, all numbers little-endian:
+//  offset  0  char[4]   "SGRD"
+//  offset  4  uint32    version (gridCodecVersion)
+//  offset  8  int32     countX, the number of rows
+//  offset 12  int32     countY, the number of values in a row
+//  offset 16  double[4] startX, startY, stepX, stepY
+//  offset 48  double    the tolerance
+//  offset 56  uint32    the number of rows in a chunk
+//  offset 60  uint32    0
+//  then for each chunk: uint32 number of rows, uint32 number of bytes, and the varint bytes
+const uint32_t gridCodecVersion = 1;
+
+//Writes z[i * countY + j] for the grid. Throws runtime_error when the tolerance is not larger than 0, when a value is
+//not a finite number or too large for the tolerance, and when the file can not be written
+void writeGridCodec(const std::string& path, const GridDomain& domain, const double* z, double tolerance,
+    int chunkRows = 64);
+
+//Reads a .grid file one chunk at a time. The constructor reads the header, and throws runtime_error when the file is
+//missing or is not a grid file
+class GridDecoder
+{
+public:
+    explicit GridDecoder(const std::string& path);
+
+    const GridDomain& domain() const { return gridDomain; }
+    double tolerance() const { return gridTolerance; }
+
+    //Decodes the next chunk into z, rowCount rows of domain().countY values starting at row firstRow.
+    //Returns false when all the rows have been read. Throws runtime_error when the file is damaged, also before
+    //anything is allocated when the chunk header asks for more bytes or values than the rest of the file can hold
+    bool readChunk(std::vector<double>& z, int& firstRow, int& rowCount);
+
+private:
+    std::string path;
+    std::ifstream file;
+    GridDomain gridDomain;
+    double gridTolerance;
+    int nextRow = 0;
+    uint64_t fileSize = 0;
+    std::vector<uint8_t> bytes;
+};
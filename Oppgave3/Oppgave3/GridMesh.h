@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//The triangles of a grid of countX rows of countY points, where point (i, j) is vertex i * countY + j.
+//Each point is stored once in the vertex buffer and the element buffer lists two triangles for each cell, so the
+//vertex shader runs once for each point instead of six times for each cell.
+//The triangles are counter-clockwise seen from above when x grows with i and y with j, the same as MeshExport.h
+
+//The number of indices for the grid: three for each triangle
+inline size_t gridIndexCount(int countX, int countY)
+{
+    return countX > 1 && countY > 1 ? 6 * static_cast<size_t>(countX - 1) * (countY - 1) : 0;
+}
+
+//Fills 'indices' with the triangles. Index is uint16_t when the grid has at most 65536 points, otherwise uint32_t
+template<typename Index>
+void buildGridIndices(int countX, int countY, std::vector<Index>& indices)
+{
+    indices.resize(gridIndexCount(countX, countY));
+    size_t k = 0;
+    for (int i = 0; i + 1 < countX; ++i) {
+        for (int j = 0; j + 1 < countY; ++j) {
+            Index corner = static_cast<Index>(static_cast<size_t>(i) * countY + j);
+            Index next = static_cast<Index>(corner + countY);
+            indices[k++] = corner;
+            indices[k++] = next;
+            indices[k++] = static_cast<Index>(next + 1);
+            indices[k++] = corner;
+            indices[k++] = static_cast<Index>(next + 1);
+            indices[k++] = static_cast<Index>(corner + 1);
+        }
+    }
+}
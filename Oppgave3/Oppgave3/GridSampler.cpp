@@ -0,0 +1,32 @@
+#include "GridSampler.h"
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+void sampleGridTiled(const GridDomain& grid, const RowFunction& evaluateRow, double* z, ThreadPool& pool,
+    int tileRows, int tileColumns)
+{
+    //The y values are the same for every row, so they are calculated once
+    vector<double> y(grid.countY);
+    for (int j = 0; j < grid.countY; ++j)
+    {
+        y[j] = grid.startY + j * grid.stepY;
+    }
+
+    int tilesX = (grid.countX + tileRows - 1) / tileRows;
+    int tilesY = (grid.countY + tileColumns - 1) / tileColumns;
+
+    pool.parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile)
+    {
+        int firstRow = static_cast<int>(tile / tilesY) * tileRows;
+        int firstColumn = static_cast<int>(tile % tilesY) * tileColumns;
+        int lastRow = min(firstRow + tileRows, grid.countX);
+        int columns = min(tileColumns, grid.countY - firstColumn);
+
+        for (int i = firstRow; i < lastRow; ++i)
+        {
+            double x = grid.startX + i * grid.stepX;
+            evaluateRow(x, y.data() + firstColumn, z + static_cast<size_t>(i) * grid.countY + firstColumn, columns);
+        }
+    });
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <functional>
+#include "ThreadPool.h"
+
+//The grid of (x, y) points: x = startX + i * stepX for i = 0..countX-1, and y in the same way
+struct GridDomain
+{
+    double startX;
+    double startY;
+    double stepX;
+    double stepY;
+    int countX;
+    int countY;
+};
+
+//Evaluates the surface for one x value and 'count' y values: z[j] = f(x, y[j])
+typedef std::function<void(double x, const double* y, double* z, int count)> RowFunction;
+
+//Samples the surface for every point of the grid into z[i * countY + j], the same order as the nested i/j loop.
+//The grid is split into tiles of tileRows x tileColumns points that are small enough to stay in the cache, and the
+//tiles are shared between the threads of the pool. Each tile writes only its own part of z, so the result does not
+//depend on which thread runs which tile
+void sampleGridTiled(const GridDomain& grid, const RowFunction& evaluateRow, double* z, ThreadPool& pool,
+    int tileRows = 16, int tileColumns = 1024);
@@ -0,0 +1,275 @@
+#pragma once
+#include <type_traits>
+
+//Expression templates for a surface z = f(x, y). The formula is written with the types below, for example
+//
+//    Symbolic::Integer<2>() * Symbolic::power<2>(Symbolic::x) * Symbolic::y
+//
+//and the whole formula becomes one type. The compiler then does the work that otherwise happens when the program runs:
+//integer powers are expanded into multiplications, parts that are 0 or 1 are removed, and derivative<0>() /
+//derivative<1>() give new types for df/dx and df/dy. A loop that calls the formula is fully inlined, so it can be
+//vectorized in the same way as hand written code
+namespace Symbolic
+{
+    //Base class of all the nodes, so the operators below only apply to formula types
+    template<typename Derived>
+    struct Node
+    {
+        const Derived& self() const { return static_cast<const Derived&>(*this); }
+    };
+
+    //x^N for an integer N >= 0 with square-and-multiply. The recursion is resolved by the compiler, so x^5 becomes
+    //three multiplications
+    template<int N>
+    struct PowerOf
+    {
+        template<typename T>
+        static T of(T x)
+        {
+            T half = PowerOf<N / 2>::of(x);
+            return N % 2 == 0 ? half * half : half * half * x;
+        }
+    };
+
+    template<>
+    struct PowerOf<1>
+    {
+        template<typename T>
+        static T of(T x) { return x; }
+    };
+
+    constexpr int integerPower(int value, int n)
+    {
+        return n == 0 ? 1 : value * integerPower(value, n - 1);
+    }
+
+    //An integer that is known when the program is compiled
+    template<int K>
+    struct Integer : Node<Integer<K>>
+    {
+        //T{} + K instead of T(K), so T can also be a Dual, which has no constructor from a number
+        template<typename T>
+        T operator()(T, T) const { return T{} + K; }
+
+        template<int I>
+        Integer<0> derivative() const { return Integer<0>(); }
+    };
+
+    //A number that is only known when the program runs, for example 0.5
+    struct Constant : Node<Constant>
+    {
+        double value;
+
+        explicit Constant(double value) : value(value) {}
+
+        template<typename T>
+        T operator()(T, T) const { return T{} + value; }
+
+        template<int I>
+        Integer<0> derivative() const { return Integer<0>(); }
+    };
+
+    //Variable number I: 0 is x and 1 is y
+    template<int I>
+    struct Variable : Node<Variable<I>>
+    {
+        static_assert(I == 0 || I == 1, "The surface only has the variables x and y");
+
+        template<typename T>
+        T operator()(T x, T y) const { return I == 0 ? x : y; }
+
+        template<int J>
+        Integer<I == J ? 1 : 0> derivative() const { return Integer<I == J ? 1 : 0>(); }
+    };
+
+    template<typename A, typename B>
+    struct Sum;
+    template<typename A, typename B>
+    struct Difference;
+    template<typename A, typename B>
+    struct Product;
+    template<typename A, int N>
+    struct Power;
+
+    //How a type is simplified: 0 for the integer 0, 1 for the integer 1 and 2 for everything else
+    template<typename A>
+    struct Kind : std::integral_constant<int, 2> {};
+    template<>
+    struct Kind<Integer<0>> : std::integral_constant<int, 0> {};
+    template<>
+    struct Kind<Integer<1>> : std::integral_constant<int, 1> {};
+
+    template<int K>
+    using KindTag = std::integral_constant<int, K>;
+
+    //a + b. Two integers are added right away and a term that is 0 is left out
+    template<int A, int B>
+    Integer<A + B> makeSum(Integer<A>, Integer<B>) { return Integer<A + B>(); }
+
+    template<typename A, typename B, int K>
+    B addTerms(const A&, const B& b, KindTag<0>, KindTag<K>) { return b; }
+    template<typename A, typename B, int K>
+    A addTerms(const A& a, const B&, KindTag<K>, KindTag<0>) { return a; }
+    template<typename A, typename B>
+    Sum<A, B> addTerms(const A& a, const B& b, KindTag<1>, KindTag<2>) { return Sum<A, B>(a, b); }
+    template<typename A, typename B>
+    Sum<A, B> addTerms(const A& a, const B& b, KindTag<2>, KindTag<1>) { return Sum<A, B>(a, b); }
+    template<typename A, typename B>
+    Sum<A, B> addTerms(const A& a, const B& b, KindTag<2>, KindTag<2>) { return Sum<A, B>(a, b); }
+
+    template<typename A, typename B>
+    auto makeSum(const A& a, const B& b)
+    {
+        return addTerms(a, b, KindTag<Kind<A>::value>(), KindTag<Kind<B>::value>());
+    }
+
+    //a - b. Two integers are subtracted right away and b is left out when it is 0
+    template<int A, int B>
+    Integer<A - B> makeDifference(Integer<A>, Integer<B>) { return Integer<A - B>(); }
+
+    template<typename A, typename B>
+    A subtractTerms(const A& a, const B&, std::true_type) { return a; }
+    template<typename A, typename B>
+    Difference<A, B> subtractTerms(const A& a, const B& b, std::false_type) { return Difference<A, B>(a, b); }
+
+    template<typename A, typename B>
+    auto makeDifference(const A& a, const B& b)
+    {
+        return subtractTerms(a, b, std::integral_constant<bool, Kind<B>::value == 0>());
+    }
+
+    //a * b. Two integers are multiplied right away, a factor 0 makes the product 0 and a factor 1 is left out
+    template<int A, int B>
+    Integer<A * B> makeProduct(Integer<A>, Integer<B>) { return Integer<A * B>(); }
+
+    template<typename A, typename B, int K>
+    Integer<0> multiplyFactors(const A&, const B&, KindTag<0>, KindTag<K>) { return Integer<0>(); }
+    template<typename A, typename B>
+    Integer<0> multiplyFactors(const A&, const B&, KindTag<1>, KindTag<0>) { return Integer<0>(); }
+    template<typename A, typename B>
+    Integer<0> multiplyFactors(const A&, const B&, KindTag<2>, KindTag<0>) { return Integer<0>(); }
+    template<typename A, typename B>
+    B multiplyFactors(const A&, const B& b, KindTag<1>, KindTag<2>) { return b; }
+    template<typename A, typename B>
+    A multiplyFactors(const A& a, const B&, KindTag<2>, KindTag<1>) { return a; }
+    template<typename A, typename B>
+    Product<A, B> multiplyFactors(const A& a, const B& b, KindTag<2>, KindTag<2>) { return Product<A, B>(a, b); }
+
+    template<typename A, typename B>
+    auto makeProduct(const A& a, const B& b)
+    {
+        return multiplyFactors(a, b, KindTag<Kind<A>::value>(), KindTag<Kind<B>::value>());
+    }
+
+    //An integer times a product that starts with an integer: 2 * (2 * x) becomes 4 * x
+    template<int A, int B, typename C>
+    auto makeProduct(Integer<A>, const Product<Integer<B>, C>& b)
+    {
+        return makeProduct(Integer<A * B>(), b.b);
+    }
+
+    //a^N. a^0 is 1, a^1 is a and an integer to an integer power is calculated right away
+    template<int N, typename A>
+    auto makePower(const A& a, std::integral_constant<bool, true>) { return Power<A, N>(a); }
+    template<int N, typename A>
+    auto makePower(const A& a, std::integral_constant<bool, false>) { return a; }
+
+    template<int N, typename A>
+    auto makePower(const A& a)
+    {
+        static_assert(N >= 1, "Only positive integer powers are supported");
+        return makePower<N>(a, std::integral_constant<bool, (N > 1)>());
+    }
+
+    template<int N, int K>
+    Integer<integerPower(K, N)> makePower(Integer<K>) { return Integer<integerPower(K, N)>(); }
+
+    template<typename A, typename B>
+    struct Sum : Node<Sum<A, B>>
+    {
+        A a;
+        B b;
+
+        Sum(const A& a, const B& b) : a(a), b(b) {}
+
+        template<typename T>
+        T operator()(T x, T y) const { return a(x, y) + b(x, y); }
+
+        template<int I>
+        auto derivative() const { return makeSum(a.template derivative<I>(), b.template derivative<I>()); }
+    };
+
+    template<typename A, typename B>
+    struct Difference : Node<Difference<A, B>>
+    {
+        A a;
+        B b;
+
+        Difference(const A& a, const B& b) : a(a), b(b) {}
+
+        template<typename T>
+        T operator()(T x, T y) const { return a(x, y) - b(x, y); }
+
+        template<int I>
+        auto derivative() const { return makeDifference(a.template derivative<I>(), b.template derivative<I>()); }
+    };
+
+    template<typename A, typename B>
+    struct Product : Node<Product<A, B>>
+    {
+        A a;
+        B b;
+
+        Product(const A& a, const B& b) : a(a), b(b) {}
+
+        template<typename T>
+        T operator()(T x, T y) const { return a(x, y) * b(x, y); }
+
+        //The product rule: (ab)' = a'b + ab'
+        template<int I>
+        auto derivative() const
+        {
+            return makeSum(makeProduct(a.template derivative<I>(), b), makeProduct(a, b.template derivative<I>()));
+        }
+    };
+
+    template<typename A, int N>
+    struct Power : Node<Power<A, N>>
+    {
+        A a;
+
+        explicit Power(const A& a) : a(a) {}
+
+        template<typename T>
+        T operator()(T x, T y) const { return PowerOf<N>::of(a(x, y)); }
+
+        //The power rule and the chain rule: (a^N)' = N a^(N-1) a'
+        template<int I>
+        auto derivative() const
+        {
+            return makeProduct(makeProduct(Integer<N>(), makePower<N - 1>(a)), a.template derivative<I>());
+        }
+    };
+
+    template<typename A, typename B>
+    auto operator+(const Node<A>& a, const Node<B>& b) { return makeSum(a.self(), b.self()); }
+
+    template<typename A, typename B>
+    auto operator-(const Node<A>& a, const Node<B>& b) { return makeDifference(a.self(), b.self()); }
+
+    template<typename A, typename B>
+    auto operator*(const Node<A>& a, const Node<B>& b) { return makeProduct(a.self(), b.self()); }
+
+    template<typename A>
+    auto operator*(double a, const Node<A>& b) { return makeProduct(Constant(a), b.self()); }
+
+    template<typename A>
+    auto operator*(const Node<A>& a, double b) { return makeProduct(a.self(), Constant(b)); }
+
+    //pow(a, N) for an integer N that is known when the program is compiled
+    template<int N, typename A>
+    auto power(const Node<A>& a) { return makePower<N>(a.self()); }
+
+    const Variable<0> x;
+    const Variable<1> y;
+}
@@ -4,16 +4,64 @@
 #include <vector>
 #include <cmath>
 #include <fstream>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <algorithm>
+#include <typeinfo>
+#include "Dual.h"
+#include "Expression.h"
+#include "ExpressionJit.h"
+#include "SurfaceTemplate.h"
+#include "GridSampler.h"
+#include "GridCodec.h"
+#include "GridMesh.h"
+#include "ThreadPool.h"
+#include "TextWriter.h"
+#include "Dataset.h"
+#include "MappedFile.h"
+#include "DataText.h"
+#include "SampleCache.h"
+#include "BulkWriter.h"
+#include "MeshExport.h"
+#include "ParallelText.h"
 using namespace std;
 
 const char* vertexShaderSource =
 "#version 330 core\n"
-"layout (location = 0) in vec3 aPos;\n"
-"layout (location = 1) in vec3 aColor;\n"
+"layout (location = 0) in float aX;\n"
+"layout (location = 1) in float aY;\n"
+"layout (location = 2) in float aZ;\n"
+"layout (location = 3) in float aRed;\n"
+"layout (location = 4) in float aGreen;\n"
+"layout (location = 5) in float aBlue;\n"
 "out vec3 color;\n"
 "void main(){\n"
-"   gl_Position = vec4(aPos, 1.0);\n"
-"   color = aColor;\n"
+"   gl_Position = vec4(aX, aY, aZ, 1.0);\n"
+"   color = vec3(aRed, aGreen, aBlue);\n"
+"}\0";
+
+//The vertex shader used when generateOnGpu is set. It has no inputs: the draw has six vertices for each cell of the grid,
+//the two triangles of buildGridIndices() in GridMesh.h, and each vertex finds its grid point from gl_VertexID.
+//function and the color must be the same as surface and calculateColor()
+const char* generatingVertexShaderSource =
+"#version 330 core\n"
+"uniform vec2 gridStart;\n"
+"uniform vec2 gridStep;\n"
+"uniform int countY;\n"
+"out vec3 color;\n"
+"float function(float x, float y){\n"
+"   return 2.0 * x * x * y;\n"
+"}\n"
+"void main(){\n"
+"   const ivec2 corners[6] = ivec2[6](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1), ivec2(0, 0), ivec2(1, 1), ivec2(0, 1));\n"
+"   int cell = gl_VertexID / 6;\n"
+"   ivec2 point = ivec2(cell / (countY - 1), cell % (countY - 1)) + corners[gl_VertexID % 6];\n"
+"   vec2 xy = gridStart + vec2(point) * gridStep;\n"
+"   gl_Position = vec4(xy, function(xy.x, xy.y), 1.0);\n"
+"   color = vec3(clamp((xy.x + 1.0) / 2.0, 0.0, 1.0));\n"
 "}\0";
 
 const char* fragmentShaderSource =
@@ -24,12 +72,81 @@ const char* fragmentShaderSource =
 "FragColor = vec4(color, 1.0);\n"
 "}\0";
 
+//The function can be given as text, for example "2*x^2*y", and is then compiled when the program starts.
+//When it is empty the C++ function(x, y) at the bottom of the file is used
+string functionExpression = "";
+
+//Set to true to also save the points in the binary file Data.bin, with one float column for each of x, y, z, r, g, b
+//(see Dataset.h). Much faster to write and read than Data.txt for large grids
+bool writeBinaryDataset = false;
+
+//Set to true to write Data.bin with a BulkWriter (see BulkWriter.h), past the page cache, when the grid is so large
+//that the file takes many GB
+bool bulkExport = false;
+
+//Set to a file name, for example "Data.ply" or "Data.obj", to also save the surface as a triangle mesh (see MeshExport.h)
+string meshExport = "";
+
+//When larger than 0 the grid is also saved in the compact file Data.grid (see GridCodec.h), with every z value at most
+//this far from the sampled value
+double gridCodecTolerance = 0.0;
+
+//Set to true to keep the samples in the folder SampleCache (see SampleCache.h). When the function and the grid are the
+//same as in an earlier run, the samples are read from there instead of being calculated again.
+bool useSampleCache = false;
+
+//When set to a file saved with writeBinaryDataset, for example "Data.bin", the program maps that file and shows it,
+//instead of sampling the function and writing Data.txt again. An old Data.txt (a name that ends with .txt) is parsed
+//and shown in the same way, and so is a Data.grid (a name that ends with .grid)
+string viewDataset = "";
+
+//Set to true to let the vertex shader make the triangles of the grid from gl_VertexID and the grid of the header, so no
+//vertex buffer is uploaded at all. Only used for function(x, y) when no dataset is viewed, since the shader has its own
+//copy of the function. Data.txt is still written from the samples on the CPU
+bool generateOnGpu = false;
+
+//Set to true to measure how fast the compiled expression is compared to the C++ function
+bool runBenchmarks = false;
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 
 void processInput(GLFWwindow* window);
 
-double function(double x, double y);
+//Used a function from the lecture notes f(x,y)=2x^2y, written as a compile time expression (see SurfaceTemplate.h).
+//This is the only place the function is written, function(x, y) evaluates it. pow(x, 2) becomes x * x, and
+//surface.derivative<0>() and surface.derivative<1>() are the partial derivatives
+const auto surface = Symbolic::Integer<2>() * Symbolic::power<2>(Symbolic::x) * Symbolic::y;
+
+template<typename T>
+T function(T x, T y);
+
+template<typename Surface>
+void sampleRow(const Surface& f, double x, const double* y, double* z, int count);
+Dual<double, 2> functionWithGradient(double x, double y);
 void calculateColor(double x, double& r, double& g, double& b);
+bool createSurface(DatasetHeader& header);
+bool sampleSurface(const GridDomain& domain, vector<double>& gridZ, vector<float>& vertexColumns, ThreadPool& pool);
+SampleKey sampleKey(const GridDomain& domain);
+void loadCachedColumns(const string& path, vector<float>& vertexColumns);
+void loadDataset(const string& path, DatasetHeader& header);
+void loadDataText(const string& path, DatasetHeader& header);
+void loadGridCodec(const string& path, DatasetHeader& header);
+bool endsWith(const string& text, const string& ending);
+void setColumnAttributes(const DatasetHeader& header);
+bool surfaceMadeOnGpu();
+GLsizei setGeneratedSurfaceUniforms(unsigned int shaderProgram, const DatasetHeader& header);
+
+//What glDrawElements needs for the element buffer of the surface. count is 0 when the points are not a grid
+struct SurfaceElements
+{
+    GLenum type = GL_UNSIGNED_INT;
+    GLsizei count = 0;
+};
+SurfaceElements uploadSurfaceElements(const DatasetHeader& header);
+void benchmarkExpression(const Expression& expression, int gridSize);
+void benchmarkSurfaceTemplate(int gridSize);
+void benchmarkTiledSampler(int gridSize);
+void benchmarkGridCodec(int gridSize, double tolerance);
 
 int main() 
 {
@@ -61,10 +178,16 @@ int main()
     glViewport(0, 0, 800, 600);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
+    bool gpuGeneration = surfaceMadeOnGpu();
+    if (generateOnGpu && !gpuGeneration) {
+        cout << "Only function(x, y) can be made on the GPU, not an expression or a dataset, so the vertices are uploaded"
+            << endl;
+    }
+
     unsigned int vertexShader, fragmentShader, shaderProgram;
 
     vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
+    glShaderSource(vertexShader, 1, gpuGeneration ? &generatingVertexShaderSource : &vertexShaderSource, nullptr);
     glCompileShader(vertexShader);
     int success;
     char infoLog[512];
@@ -98,8 +221,107 @@ int main()
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 
-    //Opens a textfile
-    ofstream outfile("Data.txt");
+    unsigned int VAO, VBO, EBO;
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    //The VAO remembers the element buffer, so it is bound once here
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    //The vertex buffer holds the columns x, y, z, r, g, b one after the other, in the same way as Data.bin.
+    //A saved dataset can then be copied into it straight from the mapped file
+    DatasetHeader surfaceHeader;
+    auto startupBegin = chrono::steady_clock::now();
+    if (!viewDataset.empty()) {
+        try {
+            if (endsWith(viewDataset, ".txt")) {
+                loadDataText(viewDataset, surfaceHeader);
+            }
+            else if (endsWith(viewDataset, ".grid")) {
+                loadGridCodec(viewDataset, surfaceHeader);
+            }
+            else {
+                loadDataset(viewDataset, surfaceHeader);
+            }
+        }
+        catch (const runtime_error& error) {
+            cout << "Failed to load " << viewDataset << ": " << error.what() << endl;
+            glfwTerminate();
+            return -1;
+        }
+    }
+    else if (!createSurface(surfaceHeader)) {
+        glfwTerminate();
+        return -1;
+    }
+    SurfaceElements surfaceElements;
+    GLsizei generatedVertexCount = 0;
+    if (gpuGeneration) {
+        generatedVertexCount = setGeneratedSurfaceUniforms(shaderProgram, surfaceHeader);
+    }
+    else {
+        surfaceElements = uploadSurfaceElements(surfaceHeader);
+    }
+    double startupSeconds = chrono::duration<double>(chrono::steady_clock::now() - startupBegin).count();
+    cout << "The surface was ready to draw after " << startupSeconds * 1000.0 << " ms" << endl;
+
+    if (runBenchmarks) {
+        //Uses the same function as the C++ code when no expression is given, so the two can be compared
+        Expression benchmarked(functionExpression.empty() ? "2*x^2*y" : functionExpression, { "x", "y" });
+        benchmarkExpression(benchmarked, 3163);
+        benchmarkSurfaceTemplate(3163);
+        benchmarkTiledSampler(8192);
+        benchmarkTextWriter(1000000);
+        benchmarkParallelText(5000000);
+        ThreadPool pool;
+        benchmarkDataText(5000000, pool);
+        benchmarkGridCodec(2000, 1e-4);
+        benchmarkBulkWriter(1024);
+        benchmarkMeshExport(4096);
+    }
+
+    while (!glfwWindowShouldClose(window)) {
+
+        processInput(window);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glUseProgram(shaderProgram);
+        glBindVertexArray(VAO);
+        if (gpuGeneration) {
+            glDrawArrays(GL_TRIANGLES, 0, generatedVertexCount);
+        }
+        else if (surfaceElements.count > 0) {
+            glDrawElements(GL_TRIANGLES, surfaceElements.count, surfaceElements.type, (void*)0);
+        }
+        else {
+            glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(surfaceHeader.pointCount));
+        }
+
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteProgram(shaderProgram);
+
+    glfwTerminate();
+
+    return 0;
+
+}
+
+//Samples the function on the grid, writes Data.txt (and Data.bin when writeBinaryDataset is set) and fills the bound
+//vertex buffer. Returns false when the function expression can not be compiled
+bool createSurface(DatasetHeader& header)
+{
+    //Opens a textfile. TextWriter keeps the lines in a large buffer, so the file is not flushed for every line
+    TextWriter outfile("Data.txt");
 
     //Definition quantity
     double a_x = -2.0; //The start of the definition quantity x- axis 
@@ -116,15 +338,177 @@ int main()
     double h_y = (b_y - a_y) / (numberOfVertices_y-1);
 
     //Shows in the top of the text file how many lines of data points is in the text file 
-    outfile << "Number of lines: " <<  numberOfVertices_x * numberOfVertices_y << endl;
+    outfile << "Number of lines: " <<  numberOfVertices_x * numberOfVertices_y << '\n';
+
+    GridDomain domain = { a_x, a_y, h_x, h_y, numberOfVertices_x, numberOfVertices_y };
+    size_t count = static_cast<size_t>(numberOfVertices_x) * numberOfVertices_y;
+
+    header.function = functionExpression.empty() ? DatasetFunction::Surface : DatasetFunction::Expression;
+    header.pointCount = count;
+    header.countX = numberOfVertices_x;
+    header.countY = numberOfVertices_y;
+    header.domainMinimumX = a_x;
+    header.domainMaximumX = b_x;
+    header.domainMinimumY = a_y;
+    header.domainMaximumY = b_y;
+    header.columnNames = { "x", "y", "z", "r", "g", "b" };
+
+    //The columns x, y, z, r, g, b for the vertex buffer and Data.bin
+    vector<float> vertexColumns(6 * count);
+    vector<const float*> columns = { &vertexColumns[0], &vertexColumns[count], &vertexColumns[2 * count],
+        &vertexColumns[3 * count], &vertexColumns[4 * count], &vertexColumns[5 * count] };
+    vector<double> gridZ;
+    ThreadPool pool;
+
+    //Looks for the same samples from an earlier run first
+    SampleKey key = sampleKey(domain);
+    unique_ptr<SampleCache> cache;
+    bool cached = false;
+    if (useSampleCache) {
+        try {
+            cache.reset(new SampleCache());
+            string path;
+            if (cache->find(key, path)) {
+                loadCachedColumns(path, vertexColumns);
+                cached = true;
+            }
+        }
+        catch (const runtime_error& error) {
+            cout << "Failed to use the sample cache: " << error.what() << endl;
+        }
+    }
+
+    if (cached) {
+        //Data.grid is made from the cached z values, which are floats
+        gridZ.assign(columns[2], columns[2] + count);
+    }
+    else {
+        if (!sampleSurface(domain, gridZ, vertexColumns, pool)) {
+            return false;
+        }
+        if (cache) {
+            try {
+                writeDataset(cache->entryPath(key), header, columns);
+                cache->store(key);
+            }
+            catch (const runtime_error& error) {
+                cout << "Failed to save the samples in the sample cache: " << error.what() << endl;
+            }
+        }
+    }
+    if (cache) {
+        cout << "Sample cache " << (cached ? "hit" : "miss") << " (" << cache->hits() << " hits, " << cache->misses()
+            << " misses, " << cache->evictions() << " evicted in all runs)" << endl;
+    }
+
+    // Writes out the coordinates to the text file. The numbers are written as floats, so the text is the same whether
+    //they were just sampled or read from the cache. The lines are formatted on all the cores and written in order
+    writeLinesInParallel(outfile, count, pool, [&](TextWriter& text, size_t k) {
+        text << "x: " << columns[0][k] << " y: " << columns[1][k] << " z: " << columns[2][k] <<
+        " red: "<< columns[3][k] << " green: " << columns[4][k] << " blue: " << columns[5][k] <<  '\n';
+    });
+
+    // Closes the textfile 
+    try {
+        outfile.close();
+    }
+    catch (const runtime_error& error) {
+        cout << "Failed to save Data.txt: " << error.what() << endl;
+    }
+
+    if (writeBinaryDataset) {
+        try {
+            writeDataset("Data.bin", header, columns, bulkExport);
+        }
+        catch (const runtime_error& error) {
+            cout << "Failed to save Data.bin: " << error.what() << endl;
+        }
+    }
+
+    if (!meshExport.empty()) {
+        MeshVertices vertices;
+        vertices.x = columns[0];
+        vertices.y = columns[1];
+        vertices.z = columns[2];
+        vertices.red = columns[3];
+        vertices.green = columns[4];
+        vertices.blue = columns[5];
+        vertices.count = count;
+        try {
+            writeGridMesh(meshExport, vertices, numberOfVertices_x, numberOfVertices_y);
+        }
+        catch (const runtime_error& error) {
+            cout << "Failed to save " << meshExport << ": " << error.what() << endl;
+        }
+    }
+
+    if (gridCodecTolerance > 0.0) {
+        try {
+            writeGridCodec("Data.grid", domain, gridZ.data(), gridCodecTolerance);
+        }
+        catch (const runtime_error& error) {
+            cout << "Failed to save Data.grid: " << error.what() << endl;
+        }
+    }
+
+    if (!surfaceMadeOnGpu()) {
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertexColumns.size(), vertexColumns.data(), GL_STATIC_DRAW);
+        setColumnAttributes(header);
+    }
+
+    cout << "The data points has been created and saved in the file 'Data.txt'" << endl;
+    return true;
+}
+
+//Samples the function on the grid into gridZ, and fills the columns x, y, z, r, g, b one after the other in
+//vertexColumns. Returns false when the function expression can not be compiled
+bool sampleSurface(const GridDomain& domain, vector<double>& gridZ, vector<float>& vertexColumns, ThreadPool& pool)
+{
+    //Compiles the expression before the sampling starts, so a typing error is found right away.
+    //The bytecode is then translated to machine code when that is possible
+    unique_ptr<ExpressionJit> surfaceExpression;
+    if (!functionExpression.empty())
+    {
+        try
+        {
+            surfaceExpression.reset(new ExpressionJit(Expression(functionExpression, { "x", "y" })));
+        }
+        catch (const runtime_error& error)
+        {
+            cout << "Failed to compile the function " << functionExpression << ": " << error.what() << endl;
+            return false;
+        }
+    }
 
-    for (int i = 0; i < numberOfVertices_x; ++i) {
-        for (int j = 0; j < numberOfVertices_y; ++j) {
-            // Calculates the values for x and y coordinates 
-            double x = a_x + i * h_x;
-            double y = a_y + j * h_y;
+    //Evaluates one row of the grid, with the compiled expression when there is one
+    RowFunction evaluateRow;
+    if (surfaceExpression) {
+        evaluateRow = [&](double x, const double* y, double* z, int count) {
+            //The expression takes x as an array as well. Each thread has its own array
+            thread_local vector<double> rowX;
+            rowX.assign(count, x);
+            const double* inputs[] = { rowX.data(), y };
+            surfaceExpression->evaluate(inputs, z, count);
+        };
+    }
+    else {
+        evaluateRow = [](double x, const double* y, double* z, int count) {
+            sampleRow(surface, x, y, z, count);
+        };
+    }
+
+    //The surface is sampled in tiles on all the cores, and then stored in the same order as before
+    size_t count = static_cast<size_t>(domain.countX) * domain.countY;
+    gridZ.resize(count);
+    sampleGridTiled(domain, evaluateRow, gridZ.data(), pool);
+
+    for (int i = 0; i < domain.countX; ++i) {
+        // Calculates the values for x coordinates 
+        double x = domain.startX + i * domain.stepX;
 
-            double z = function(x, y);
+        for (int j = 0; j < domain.countY; ++j) {
+            double y = domain.startY + j * domain.stepY;
+            size_t index = static_cast<size_t>(i) * domain.countY + j;
 
             //Calculates the rbg values based on the x value 
             double r;
@@ -132,56 +516,249 @@ int main()
             double b;
             calculateColor(x, r, g, b);
 
-            // Writes out the coordinates to the text file 
-            outfile << "x: " << x << " y: " << y << " z: " << z << 
-            " red: "<< r << " green: " << g << " blue: " << b<<  endl;
+            double values[] = { x, y, gridZ[index], r, g, b };
+            for (int c = 0; c < 6; ++c) {
+                vertexColumns[c * count + index] = static_cast<float>(values[c]);
+            }
         }
     }
+    return true;
+}
 
-    // Closes the textfile 
-    outfile.close();
+//Everything that changes the samples. Two runs with the same key make the same Data.txt
+SampleKey sampleKey(const GridDomain& domain)
+{
+    //The type of surface spells out the whole formula, except the values of numbers like 0.5, which change its value at
+    //any point. A changed surface then gives another key by itself
+    SampleKey key(functionExpression.empty() ? string("Oppgave3 surface ") + typeid(surface).name() : functionExpression);
+    if (functionExpression.empty()) {
+        key.add("surface(0.3, 0.7)", surface(0.3, 0.7));
+    }
+    key.add("startX", domain.startX).add("startY", domain.startY).add("stepX", domain.stepX)
+        .add("stepY", domain.stepY).add("countX", static_cast<long long>(domain.countX))
+        .add("countY", static_cast<long long>(domain.countY))
+        .add("precision", "float").add("datasetVersion", static_cast<long long>(datasetVersion));
+    return key;
+}
 
-    unsigned int VAO, VBO;
+//Copies the columns x, y, z, r, g, b of a cached Data.bin into vertexColumns. Throws runtime_error when the file can
+//not be read or has another number of points, and then vertexColumns is not changed
+void loadCachedColumns(const string& path, vector<float>& vertexColumns)
+{
+    MappedFile file(path);
+    DatasetHeader header = readDatasetHeader(file.data(), file.size(), path);
+    size_t count = vertexColumns.size() / 6;
+    if (header.pointCount != count) {
+        throw runtime_error(path + " has " + to_string(header.pointCount) + " points, the grid has " + to_string(count));
+    }
+    const char* names[] = { "x", "y", "z", "r", "g", "b" };
+    const float* cachedColumns[6];
+    for (int c = 0; c < 6; ++c) {
+        cachedColumns[c] = datasetColumn(file, header, names[c]);
+    }
+    for (int c = 0; c < 6; ++c) {
+        copy(cachedColumns[c], cachedColumns[c] + count, vertexColumns.begin() + c * count);
+    }
+}
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+//Maps a dataset saved with writeBinaryDataset and copies its columns into the bound vertex buffer. The columns are
+//copied from the mapped pages by glBufferData, so the only work is reading the file from the disk.
+//Throws runtime_error when the file is missing or is not a dataset
+void loadDataset(const string& path, DatasetHeader& header)
+{
+    auto begin = chrono::steady_clock::now();
+    MappedFile file(path);
+    header = readDatasetHeader(file.data(), file.size(), path);
+    //Checks that the file holds all the columns before anything is read from them
+    datasetColumn(file, header, header.columnNames.back());
+    double mapSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
 
-    glBindVertexArray(VAO);
+    begin = chrono::steady_clock::now();
+    uint64_t columnBytes = header.columnOffset(header.columnNames.size()) - header.columnOffset(0);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(columnBytes), file.data() + header.columnOffset(0),
+        GL_STATIC_DRAW);
+    setColumnAttributes(header);
+    double uploadSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * numberOfVertices_x * numberOfVertices_y * 6, nullptr, GL_STATIC_DRAW);
+    cout << "Loaded " << header.pointCount << " points (" << columnBytes / (1024.0 * 1024.0) << " MB) from " << path
+        << ": mapping " << mapSeconds * 1000.0 << " ms, copying into the vertex buffer " << uploadSeconds * 1000.0
+        << " ms" << endl;
+}
 
-  
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+//Parses a Data.txt written by this program and copies its columns into the bound vertex buffer, in the same layout as
+//Data.bin. Throws runtime_error when the file can not be read or a line is not in the format of the first line
+void loadDataText(const string& path, DatasetHeader& header)
+{
+    auto begin = chrono::steady_clock::now();
+    ThreadPool pool;
+    DataTable table = readDataText(path, pool);
+    double parseSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
 
-    // Color attributes
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    begin = chrono::steady_clock::now();
+    header = DatasetHeader();
+    header.function = DatasetFunction::Surface;
+    header.pointCount = table.rowCount();
+    for (const string& name : table.columnNames) {
+        //Data.txt calls the colors red, green and blue
+        header.columnNames.push_back(name == "red" ? "r" : name == "green" ? "g" : name == "blue" ? "b" : name);
+    }
+    //Data.txt does not store the size of the grid. Every row has the same x, so the length of a row is the number of
+    //lines with the x of the first line
+    const vector<float>* x = table.column("x");
+    if (x != nullptr && !x->empty()) {
+        size_t rowLength = 1;
+        while (rowLength < x->size() && (*x)[rowLength] == (*x)[0]) {
+            ++rowLength;
+        }
+        if (x->size() % rowLength == 0) {
+            header.countX = static_cast<uint32_t>(x->size() / rowLength);
+            header.countY = static_cast<uint32_t>(rowLength);
+        }
+    }
+    size_t columnBytes = sizeof(float) * table.rowCount();
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(columnBytes * table.columns.size()), nullptr, GL_STATIC_DRAW);
+    for (size_t c = 0; c < table.columns.size(); ++c) {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(c * columnBytes), static_cast<GLsizeiptr>(columnBytes),
+            table.columns[c].data());
+    }
+    setColumnAttributes(header);
+    double uploadSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
 
-    cout << "The data points has been created and saved in the file 'Data.txt'" << endl;
+    cout << "Loaded " << header.pointCount << " points from " << path << ": parsing " << parseSeconds * 1000.0
+        << " ms, copying into the vertex buffer " << uploadSeconds * 1000.0 << " ms" << endl;
+}
 
-    while (!glfwWindowShouldClose(window)) {
+//Decodes a Data.grid one chunk of rows at a time and copies the rows into the bound vertex buffer, in the same layout
+//as Data.bin. x and y come from the grid and the colors are calculated from x, as when the grid is sampled.
+//Throws runtime_error when the file is missing or damaged
+void loadGridCodec(const string& path, DatasetHeader& header)
+{
+    auto begin = chrono::steady_clock::now();
+    GridDecoder decoder(path);
+    const GridDomain& domain = decoder.domain();
+    size_t count = static_cast<size_t>(domain.countX) * domain.countY;
 
-        processInput(window);
+    header = DatasetHeader();
+    header.function = DatasetFunction::Surface;
+    header.pointCount = count;
+    header.countX = domain.countX;
+    header.countY = domain.countY;
+    header.domainMinimumX = domain.startX;
+    header.domainMaximumX = domain.startX + (domain.countX - 1) * domain.stepX;
+    header.domainMinimumY = domain.startY;
+    header.domainMaximumY = domain.startY + (domain.countY - 1) * domain.stepY;
+    header.columnNames = { "x", "y", "z", "r", "g", "b" };
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(6 * count * sizeof(float)), nullptr, GL_STATIC_DRAW);
 
-        glClear(GL_COLOR_BUFFER_BIT);
-        glUseProgram(shaderProgram);
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, numberOfVertices_x * numberOfVertices_y); 
+    vector<double> z;
+    vector<float> chunkColumns;
+    int firstRow, rowCount;
+    while (decoder.readChunk(z, firstRow, rowCount)) {
+        size_t chunkCount = z.size();
+        chunkColumns.resize(6 * chunkCount);
+        for (int i = 0; i < rowCount; ++i) {
+            double x = domain.startX + (firstRow + i) * domain.stepX;
+            double r, g, b;
+            calculateColor(x, r, g, b);
+            for (int j = 0; j < domain.countY; ++j) {
+                size_t index = static_cast<size_t>(i) * domain.countY + j;
+                double values[] = { x, domain.startY + j * domain.stepY, z[index], r, g, b };
+                for (int c = 0; c < 6; ++c) {
+                    chunkColumns[c * chunkCount + index] = static_cast<float>(values[c]);
+                }
+            }
+        }
+        size_t firstIndex = static_cast<size_t>(firstRow) * domain.countY;
+        for (int c = 0; c < 6; ++c) {
+            glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>((c * count + firstIndex) * sizeof(float)),
+                static_cast<GLsizeiptr>(chunkCount * sizeof(float)), &chunkColumns[c * chunkCount]);
+        }
+    }
+    setColumnAttributes(header);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    cout << "Loaded " << count << " points from " << path << " (tolerance " << decoder.tolerance() << ") in "
+        << seconds * 1000.0 << " ms" << endl;
+}
+
+//Makes the element buffer with two triangles for each cell of the grid and copies it into the bound
+//GL_ELEMENT_ARRAY_BUFFER. The indices are 16-bit when the grid has at most 65536 points, which halves the buffer.
+//Returns a count of 0 when the points are not a whole grid, and they are then drawn as points
+SurfaceElements uploadSurfaceElements(const DatasetHeader& header)
+{
+    SurfaceElements elements;
+    size_t indexCount = gridIndexCount(static_cast<int>(header.countX), static_cast<int>(header.countY));
+    if (indexCount == 0 || static_cast<uint64_t>(header.countX) * header.countY != header.pointCount) {
+        cout << "The points are not a grid, so they are drawn as points" << endl;
+        return elements;
+    }
+    if (indexCount > static_cast<size_t>(INT32_MAX)) {
+        cout << "The grid has too many triangles for one draw call, so the points are drawn as points" << endl;
+        return elements;
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    size_t indexSize;
+    if (header.pointCount <= 65536) {
+        vector<uint16_t> indices;
+        buildGridIndices(static_cast<int>(header.countX), static_cast<int>(header.countY), indices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
+        elements.type = GL_UNSIGNED_SHORT;
+        indexSize = sizeof(uint16_t);
+    }
+    else {
+        vector<uint32_t> indices;
+        buildGridIndices(static_cast<int>(header.countX), static_cast<int>(header.countY), indices);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * indices.size(), indices.data(), GL_STATIC_DRAW);
+        elements.type = GL_UNSIGNED_INT;
+        indexSize = sizeof(uint32_t);
+    }
+    elements.count = static_cast<GLsizei>(indexCount);
 
-    glfwTerminate();
+    //A triangle list without indices would need all six columns for every corner of every triangle
+    size_t vertexSize = header.columnNames.size() * sizeof(float);
+    double indexedBytes = static_cast<double>(header.pointCount * vertexSize + indexCount * indexSize);
+    double listBytes = static_cast<double>(indexCount * vertexSize);
+    cout << "The surface has " << indexCount / 3 << " triangles with " << indexSize * 8 << "-bit indices: "
+        << indexedBytes / (1024.0 * 1024.0) << " MB, " << listBytes / indexedBytes
+        << "x less than the same triangles without indices" << endl;
+    return elements;
+}
 
-    return 0;
+//Points the vertex attributes x, y, z, r, g, b to their columns in the bound vertex buffer, which holds the columns
+//of the dataset in the order of the header. Throws runtime_error when one of them is missing
+void setColumnAttributes(const DatasetHeader& header)
+{
+    const char* names[] = { "x", "y", "z", "r", "g", "b" };
+    for (unsigned int location = 0; location < 6; ++location) {
+        int column = header.findColumn(names[location]);
+        if (column < 0) {
+            throw runtime_error(string("The dataset has no column called ") + names[location]);
+        }
+        uint64_t offset = header.columnOffset(column) - header.columnOffset(0);
+        glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)offset);
+        glEnableVertexAttribArray(location);
+    }
+}
 
+//True when generateOnGpu is set and the vertex shader can make the surface, which is only function(x, y)
+bool surfaceMadeOnGpu()
+{
+    return generateOnGpu && functionExpression.empty() && viewDataset.empty();
+}
+
+//Gives the grid of the header to the vertex shader that makes the surface, and returns the number of vertices to draw:
+//six for each cell. Changing the grid only needs these lines, not new samples and a new buffer
+GLsizei setGeneratedSurfaceUniforms(unsigned int shaderProgram, const DatasetHeader& header)
+{
+    int countX = static_cast<int>(header.countX);
+    int countY = static_cast<int>(header.countY);
+    float stepX = countX > 1 ? static_cast<float>((header.domainMaximumX - header.domainMinimumX) / (countX - 1)) : 0.0f;
+    float stepY = countY > 1 ? static_cast<float>((header.domainMaximumY - header.domainMinimumY) / (countY - 1)) : 0.0f;
+    glUniform2f(glGetUniformLocation(shaderProgram, "gridStart"), static_cast<float>(header.domainMinimumX),
+        static_cast<float>(header.domainMinimumY));
+    glUniform2f(glGetUniformLocation(shaderProgram, "gridStep"), stepX, stepY);
+    glUniform1i(glGetUniformLocation(shaderProgram, "countY"), countY);
+    return static_cast<GLsizei>(gridIndexCount(countX, countY));
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -199,10 +776,33 @@ void processInput(GLFWwindow* window)
     }
 }
 
-//Used a function from the lecture notes f(x,y)=2x^2y
-double function(double x, double y)
+bool endsWith(const string& text, const string& ending)
+{
+    return text.size() >= ending.size() && text.compare(text.size() - ending.size(), ending.size(), ending) == 0;
+}
+
+//The function f(x,y)=2x^2y from 'surface' at the top of the file, which is where it is changed.
+//The function is a template, so it can be evaluated with double for the value or with a Dual for the gradient
+template<typename T>
+T function(T x, T y)
 {
-    return 2.0 * pow(x, 2) * y;
+    return surface(x, y);
+}
+
+//Evaluates the function one time with dual numbers. The result holds z and the exact partial derivatives
+//dz/dx in gradient[0] and dz/dy in gradient[1]
+Dual<double, 2> functionWithGradient(double x, double y)
+{
+    return ::function(Dual<double, 2>::variable(x, 0), Dual<double, 2>::variable(y, 1));
+}
+
+//Samples one row of the grid. The loop is made for each surface type, so the whole formula is inlined into it
+template<typename Surface>
+void sampleRow(const Surface& f, double x, const double* y, double* z, int count)
+{
+    for (int j = 0; j < count; ++j) {
+        z[j] = f(x, y[j]);
+    }
 }
 
 //This function map the input value x from its original number to normalized 
@@ -221,3 +821,204 @@ void calculateColor(double x, double& r, double& g, double& b) {
     b = max(0.0, min(1.0, b));
 
 }
+
+//Samples a gridSize x gridSize grid (3163 x 3163 is about 10^7 points) with the C++ function and with the compiled
+//expression (both the interpreter and the machine code), and prints the points per second for each.
+//The grid is made one row at a time so it fits in the cache
+void benchmarkExpression(const Expression& expression, int gridSize)
+{
+    vector<double> rowX(gridSize), rowY(gridSize), rowZ(gridSize);
+    double h = 4.0 / (gridSize - 1);
+    for (int j = 0; j < gridSize; ++j) {
+        rowY[j] = -2.0 + j * h;
+    }
+    double numberOfPoints = static_cast<double>(gridSize) * gridSize;
+    //Sums up the results so the compiler can not remove the loops
+    double checksum = 0.0;
+
+    auto begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        double x = -2.0 + i * h;
+        for (int j = 0; j < gridSize; ++j) {
+            rowZ[j] = ::function(x, rowY[j]);
+        }
+        checksum += rowZ[i];
+    }
+    double nativeSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        fill(rowX.begin(), rowX.end(), -2.0 + i * h);
+        const double* inputs[] = { rowX.data(), rowY.data() };
+        expression.evaluate(inputs, rowZ.data(), gridSize);
+        checksum += rowZ[i];
+    }
+    double expressionSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    ExpressionJit jit(expression);
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        fill(rowX.begin(), rowX.end(), -2.0 + i * h);
+        const double* inputs[] = { rowX.data(), rowY.data() };
+        jit.evaluate(inputs, rowZ.data(), gridSize);
+        checksum += rowZ[i];
+    }
+    double jitSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    cout << "C++ function: " << numberOfPoints / nativeSeconds << " points/second" << endl;
+    cout << "Compiled expression " << expression.source() << " (" << expression.instructions().size() << " instructions): "
+        << numberOfPoints / expressionSeconds << " points/second, " << expressionSeconds / nativeSeconds
+        << "x the time of the C++ function" << endl;
+    cout << "Machine code (" << jit.backendName() << "): " << numberOfPoints / jitSeconds << " points/second, "
+        << jitSeconds / nativeSeconds << "x the time of the C++ function" << endl;
+    cout << "Checksum: " << checksum << endl;
+}
+
+//Samples a gridSize x gridSize grid with the compile time surface, and the gradient with dual numbers and with the
+//derivative types of the surface
+void benchmarkSurfaceTemplate(int gridSize)
+{
+    vector<double> rowY(gridSize), rowZ(gridSize), rowDx(gridSize), rowDy(gridSize);
+    double h = 4.0 / (gridSize - 1);
+    for (int j = 0; j < gridSize; ++j) {
+        rowY[j] = -2.0 + j * h;
+    }
+    double numberOfPoints = static_cast<double>(gridSize) * gridSize;
+    double checksum = 0.0;
+
+    auto begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        sampleRow(surface, -2.0 + i * h, rowY.data(), rowZ.data(), gridSize);
+        checksum += rowZ[i];
+    }
+    double templateSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        double x = -2.0 + i * h;
+        for (int j = 0; j < gridSize; ++j) {
+            Dual<double, 2> z = functionWithGradient(x, rowY[j]);
+            rowDx[j] = z.gradient[0];
+            rowDy[j] = z.gradient[1];
+        }
+        checksum += rowDx[i] + rowDy[i];
+    }
+    double dualSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    const auto surfaceDx = surface.derivative<0>();
+    const auto surfaceDy = surface.derivative<1>();
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < gridSize; ++i) {
+        double x = -2.0 + i * h;
+        sampleRow(surfaceDx, x, rowY.data(), rowDx.data(), gridSize);
+        sampleRow(surfaceDy, x, rowY.data(), rowDy.data(), gridSize);
+        checksum += rowDx[i] + rowDy[i];
+    }
+    double derivativeSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    cout << "Compile time surface: " << numberOfPoints / templateSeconds << " points/second" << endl;
+    cout << "Gradient with dual numbers: " << numberOfPoints / dualSeconds << " points/second" << endl;
+    cout << "Gradient with compile time derivatives: " << numberOfPoints / derivativeSeconds << " points/second, "
+        << derivativeSeconds / dualSeconds << "x the time of the dual numbers" << endl;
+    cout << "Checksum: " << checksum << endl;
+}
+
+//Samples a gridSize x gridSize grid (8192 x 8192 is about 6.7 * 10^7 points) with the tiled sampler, first on one thread
+//and then on twice as many threads each time up to the number of cores, and prints the points per second and how many
+//times faster it is than one thread
+void benchmarkTiledSampler(int gridSize)
+{
+    GridDomain domain = { -2.0, -2.0, 4.0 / (gridSize - 1), 4.0 / (gridSize - 1), gridSize, gridSize };
+    vector<double> gridZ(static_cast<size_t>(gridSize) * gridSize);
+    RowFunction evaluateRow = [](double x, const double* y, double* z, int count) {
+        sampleRow(surface, x, y, z, count);
+    };
+    double numberOfPoints = static_cast<double>(gridSize) * gridSize;
+
+    unsigned int cores = max(1u, thread::hardware_concurrency());
+    double oneThreadSeconds = 0.0;
+    for (unsigned int threads = 1; ; threads = min(threads * 2, cores)) {
+        ThreadPool pool(threads);
+        //The first run puts the grid into memory, the second is measured
+        sampleGridTiled(domain, evaluateRow, gridZ.data(), pool);
+        auto begin = chrono::steady_clock::now();
+        sampleGridTiled(domain, evaluateRow, gridZ.data(), pool);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        if (threads == 1) {
+            oneThreadSeconds = seconds;
+        }
+
+        cout << "Tiled sampler with " << threads << " threads: " << numberOfPoints / seconds << " points/second, "
+            << oneThreadSeconds / seconds << "x one thread" << endl;
+        if (threads == cores) {
+            break;
+        }
+    }
+    cout << "Checksum: " << gridZ[gridZ.size() / 3] << endl;
+}
+
+//Samples a gridSize x gridSize grid and saves it both in the format of Data.txt and with the grid codec. Prints the size
+//of both files, the time to read each of them back and the largest error of the decoded z values
+void benchmarkGridCodec(int gridSize, double tolerance)
+{
+    GridDomain domain = { -2.0, -2.0, 4.0 / (gridSize - 1), 4.0 / (gridSize - 1), gridSize, gridSize };
+    vector<double> gridZ(static_cast<size_t>(gridSize) * gridSize);
+    ThreadPool pool;
+    sampleGridTiled(domain, [](double x, const double* y, double* z, int count) {
+        sampleRow(surface, x, y, z, count);
+    }, gridZ.data(), pool);
+
+    const char* textPath = "GridCodecBenchmark.txt";
+    const char* gridPath = "GridCodecBenchmark.grid";
+    {
+        TextWriter text(textPath);
+        text << "Number of lines: " << gridZ.size() << '\n';
+        for (int i = 0; i < gridSize; ++i) {
+            double x = domain.startX + i * domain.stepX;
+            double r, g, b;
+            calculateColor(x, r, g, b);
+            for (int j = 0; j < gridSize; ++j) {
+                text << "x: " << x << " y: " << domain.startY + j * domain.stepY << " z: " << gridZ[i * gridSize + j] <<
+                    " red: " << r << " green: " << g << " blue: " << b << '\n';
+            }
+        }
+    }
+    auto begin = chrono::steady_clock::now();
+    writeGridCodec(gridPath, domain, gridZ.data(), tolerance);
+    double encodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    DataTable table = readDataText(textPath, pool);
+    double textSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    double largestError = 0.0;
+    {
+        GridDecoder decoder(gridPath);
+        vector<double> z;
+        int firstRow, rowCount;
+        while (decoder.readChunk(z, firstRow, rowCount)) {
+            const double* sampled = &gridZ[static_cast<size_t>(firstRow) * gridSize];
+            for (size_t k = 0; k < z.size(); ++k) {
+                largestError = max(largestError, fabs(z[k] - sampled[k]));
+            }
+        }
+    }
+    double decodeSeconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    double textMegabytes, gridMegabytes;
+    {
+        ifstream text(textPath, ios::binary | ios::ate);
+        ifstream grid(gridPath, ios::binary | ios::ate);
+        textMegabytes = static_cast<double>(text.tellg()) / (1024.0 * 1024.0);
+        gridMegabytes = static_cast<double>(grid.tellg()) / (1024.0 * 1024.0);
+    }
+    remove(textPath);
+    remove(gridPath);
+
+    cout << "Data.txt format: " << textMegabytes << " MB, read in " << textSeconds * 1000.0 << " ms" << endl;
+    cout << "Grid codec with tolerance " << tolerance << ": " << gridMegabytes << " MB (" << textMegabytes / gridMegabytes
+        << "x smaller), written in " << encodeSeconds * 1000.0 << " ms, read in " << decodeSeconds * 1000.0 << " ms ("
+        << textSeconds / decodeSeconds << "x faster), largest error " << largestError << endl;
+    cout << "Checksum: " << table.columns[2][table.rowCount() / 3] << endl;
+}